@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+
+struct T6;
+typedef double DATE;
+
+namespace Bars {
+
+// Live trendbar tail (SubscribeLiveTrendbarReq 2135)
+// For every (symbol, period) that BrokerHistory2 downloads up to "now",
+// the plugin subscribes to live trendbars and keeps the most recent
+// RING_BARS bars in memory, seeded from the download and updated from the
+// "trendbar" array of SpotEvents. Recent-window history requests are then
+// answered from memory without a GetTrendbarsReq round trip.
+
+constexpr int RING_BARS = 4096;  // bars kept per (symbol, period)
+
+// Store freshly downloaded bars (newest first) and start the live subscription.
+// Ignored unless the newest bar is within two periods of the current time.
+void Seed(const char* symbolName, int nTickMinutes, int period, const T6* bars, int count);
+
+// Serve a BrokerHistory2 request from the ring (newest first).
+// Returns 0 if the ring is not live or does not cover the request.
+int Read(const char* symbolName, DATE tStart, DATE tEnd, int nTickMinutes, int nTicks, T6* out);
+
+// True once any live trendbar subscription exists (cheap hot-path check)
+bool AnyLive();
+
+// Apply the "trendbar" array of a SpotEvent (NetworkThread)
+void HandleSpotTrendbars(long long symbolId, const char* buffer, double bid, double ask);
+
+// After reconnect: resend live subscriptions; rings need a fresh seed
+// because bars may have been missed while disconnected.
+void BatchResubscribe();
+
+// Count subscribed live trendbar streams per symbol handle (refs sized by the caller)
+void CountLive(std::vector<int>& refs);
+
+// Drop all rings (new session)
+void Reset();
+
+} // namespace Bars
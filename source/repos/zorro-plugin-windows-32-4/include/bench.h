@@ -0,0 +1,13 @@
+#pragma once
+
+namespace Bench {
+
+// In-process micro benchmarks (DO_BENCHMARK command)
+// Each benchmark works on private scratch data and never touches live state,
+// so it can be run while connected. Results go to the log under "BENCH".
+
+// Run benchmark `id` (BENCH_* in zorro_constants.h)
+// Returns the primary metric of that benchmark, 0 for an unknown id.
+double Run(int id);
+
+} // namespace Bench
@@ -0,0 +1,40 @@
+#pragma once
+
+struct T2;
+
+namespace Book {
+
+// Depth of market (SubscribeDepthQuotesReq / DepthEvent 2155)
+// One order book per subscribed symbol, updated only by the NetworkThread.
+// Readers get a seqlock-published snapshot of the top BOOK_LEVELS price
+// levels per side and never block the NetworkThread.
+
+constexpr int BOOK_LEVELS = 32;  // aggregated price levels per side in a snapshot
+
+// Subscribe to depth quotes for a symbol (idempotent, allocates its book)
+bool Subscribe(const char* symbolName);
+
+// Resend depth subscriptions after reconnect; books restart empty
+void BatchResubscribe();
+
+// Process DepthEvent (NetworkThread)
+void HandleDepthEvent(const char* buffer);
+
+// GET_BOOK: fill out[] with the latest snapshot, bids first (negative fPrice)
+// Subscribes on first use and waits up to 1s for the first DepthEvent.
+// Returns number of quotes written.
+int GetBook(const char* symbolName, T2* out, int maxQuotes);
+
+// Drop all books (new session, NetworkThread stopped)
+void Reset();
+
+// Scratch books for Bench: same update/publish code, never subscribed
+struct OrderBook;
+OrderBook* CreateScratch();
+void DestroyScratch(OrderBook* book);
+void ApplyNew(OrderBook* book, unsigned long long quoteId, long long rawPrice, long long size, bool isBid);
+void ApplyDelete(OrderBook* book, unsigned long long quoteId);
+void Publish(OrderBook* book, long long timeMs);
+int ReadSnapshot(const OrderBook* book, T2* out, int maxQuotes);
+
+} // namespace Book
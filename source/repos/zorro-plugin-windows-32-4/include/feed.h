@@ -0,0 +1,26 @@
+#pragma once
+
+namespace Feed {
+
+// Quote apply stage
+// The NetworkThread parses a SpotEvent, feeds the per-tick consumers
+// (journal, tick ring, spread, live bars) and applies the quote to the quote
+// table right here, with no queue, lock or thread hop in between. Every quote
+// still has to be parsed and recorded, so a separate conflating dispatcher
+// would only add latency.
+
+// Apply the latest full quote of a symbol (NetworkThread, the only writer of G.quotes).
+// rawBid/rawAsk are full prices (PRICE_SCALE).
+void Post(int handle, long long rawBid, long long rawAsk, long long ts);
+
+// Even between quote applies, odd while one is written. Readers of several
+// quotes compare it before and after to get quotes between two applies.
+unsigned ApplySeq();
+
+// Log quote counts over the last interval (NetworkThread, with Stats::LogSnapshot)
+void LogSnapshot();
+
+// Drop counters (new session, threads stopped)
+void Reset();
+
+} // namespace Feed
@@ -0,0 +1,28 @@
+#pragma once
+
+struct QuoteStats;
+
+namespace Health {
+
+// Per-symbol quote freshness
+// Every SpotEvent updates lock-free counters of its symbol: arrival count,
+// time since the previous SpotEvent and server-to-local latency (event
+// timestamp against the QueryPerformanceCounter receive time mapped to UTC).
+// Gaps and latencies go into log2 millisecond histograms, see QuoteStats.
+
+// Count one SpotEvent (NetworkThread). serverMs = 0 if the event carried no timestamp.
+void RecordQuote(int handle, long long serverMs, long long recvTicks);
+
+// Freshness of out->symbol since login (any thread)
+bool GetStats(QuoteStats* out);
+
+// Close the quotes-per-second window and recalibrate the receive clock (NetworkThread, every 60s)
+void Roll();
+
+// Warn about subscribed symbols that went quiet while others still quote (NetworkThread)
+void LogSnapshot();
+
+// Clear all counters (new session, threads stopped)
+void Reset();
+
+} // namespace Health
@@ -0,0 +1,48 @@
+#pragma once
+
+struct T6;
+typedef double DATE;
+
+namespace HistStore {
+
+// Local bar history store
+// One file per symbol, bar period and time block:
+//   History\Bars\{Asset}_{M1|H1|D1...}_{block}.hst
+// Blocks are calendar months below H1 and calendar years from H1 up, so
+// M1, H1 and D1 downloads never share a file and Zorro's own
+// History\{Asset}_{year}.t6 files are left alone. Each file holds a header,
+// a sparse time index (every INDEX_STRIDE-th bar) and the bars in ascending
+// time order; a [tStart, tEnd] lookup is a binary search, not a scan.
+// Blocks are read through memory-mapped views kept open across calls.
+// Each block also records the time spans it fully covers, so a caller can
+// download only what is missing.
+
+constexpr int INDEX_STRIDE = 256;  // bars per index entry
+
+// Covered interval: every bar opening in [from, to] is stored
+struct Span {
+    DATE from;
+    DATE to;
+};
+
+// Bars of [tStart, tEnd] (bar period nTickMinutes), newest first, up to nTicks,
+// stitched across as many blocks as the range spans.
+// Returns the number of bars copied (0 = nothing stored for that range).
+int Read(const char* asset, int nTickMinutes, DATE tStart, DATE tEnd, int nTicks, T6* out);
+
+// Stored bars in [tStart, tEnd]
+int Count(const char* asset, int nTickMinutes, DATE tStart, DATE tEnd);
+
+// Parts of [tStart, tEnd] not covered yet, newest first, up to maxGaps.
+// Returns the number of gaps (0 = fully covered).
+int Missing(const char* asset, int nTickMinutes, DATE tStart, DATE tEnd, Span* gaps, int maxGaps);
+
+// Merge downloaded bars (newest first) into the blocks they fall in and mark
+// [coveredFrom, coveredTo] as covered (coveredFrom > coveredTo: no coverage).
+// Stored bars with the same time are replaced.
+void Write(const char* asset, int nTickMinutes, const T6* bars, int count, DATE coveredFrom, DATE coveredTo);
+
+// Unmap all blocks (logout, close)
+void Release();
+
+} // namespace HistStore
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+
+struct T6;
+struct IndicatorDef;
+
+namespace Indicators {
+
+// Rolling indicators per (symbol, bar period)
+// Quotes applied by Feed::Post build BID bars per stream; when a bar
+// closes, every indicator of the stream is updated in O(1): EMA and ATR as
+// recursive filters, SMA and return variance from running sums over a window
+// ring, min/max from monotonic deques. The filters and sums are kept as flat
+// arrays in which each stream owns a contiguous range, so a bar close touches
+// only the closing stream's indicators. The SSE2 kernels step that range two
+// at a time; with a few indicators per stream most of it is the scalar tail.
+// Streams that have indicators are seeded from BrokerHistory2 downloads;
+// a new indicator replays its stream's closed bars.
+
+constexpr int MAX_INDICATORS = 1024;
+constexpr int HIST_BARS = 1024;      // closed bars kept per stream, also the longest window
+
+// SET_INDICATOR (Zorro thread). Returns the indicator id (1..), 0 if invalid.
+int Define(const IndicatorDef* def);
+
+// GET_INDICATORS: values of all indicators by id (out[id - 1]), 0 while warming up.
+// out == NULL returns the number of indicators to size the buffer with.
+// Writes only ids the caller was given (by Define or a NULL query) and
+// returns the number of values written.
+int GetValues(double* out);
+
+// Update the bar of the symbol's streams (NetworkThread, after the quote table)
+void OnQuote(int handle, double bid, long long serverMs);
+
+// Close bars whose period has ended, even without a further quote
+// (NetworkThread loop, and GetValues so a read never sees an overdue bar)
+void Tick();
+
+// Replace the stream's bars with a download that reaches the present (newest first).
+// Symbols and periods without an indicator are ignored.
+void Seed(int handle, int nTickMinutes, const T6* bars, int count);
+
+// Count streams per symbol handle (refs sized by the caller), for Subs
+void CountStreams(std::vector<int>& refs);
+
+// Drop all streams and indicators (new session, threads stopped)
+void Reset();
+
+} // namespace Indicators
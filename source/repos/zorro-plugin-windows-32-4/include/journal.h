@@ -0,0 +1,41 @@
+#pragma once
+
+struct T6;
+
+namespace Journal {
+
+// Live tick journal (SET_TICKJOURNAL)
+// HandleSpotEvent hands every quote to a lock-free SPSC ring; a recorder
+// thread appends them to History\Ticks\{Symbol}_{YYYYMMDD}.ctj through a
+// memory-mapped, delta/varint-encoded writer. One file per symbol per UTC day.
+// Each file also records the time spans it recorded without interruption, so
+// a reader serves only ranges the journal really covers.
+
+// Start/stop the recorder thread. Stop drains the ring, closes all files and
+// returns once the thread has exited.
+void Start();
+void Stop();
+bool IsRunning();
+
+// Queue one quote (NetworkThread). rawBid/rawAsk are full prices (PRICE_SCALE),
+// not the partial values of the SpotEvent. No-op when the recorder is stopped.
+void Record(int handle, long long symbolId, long long serverMs, long long rawBid, long long rawAsk);
+
+// The stream of this symbol was interrupted (unsubscribe, reconnect):
+// the recorded span ends at the last quote before the break
+void Break(int handle);
+void BreakAll();
+
+// Journaled ticks of [startMs, endMs] as Zorro T6 ticks, newest first
+// (fClose = bid, fVal = spread, fVol = 1 - same layout as the GetTickData path).
+// live = symbol subscribed and connected, so an unbroken span runs up to now.
+// Returns 0 unless the recorded spans cover the end of the range; otherwise
+// *uncoveredEndMs receives the end of the older part they do not cover
+// (< startMs when the whole range was served).
+int ReadTicks(int handle, const char* symbolName, bool live, long long startMs, long long endMs,
+              int maxTicks, T6* out, long long* uncoveredEndMs);
+
+// Drop decoded days (new session)
+void Reset();
+
+} // namespace Journal
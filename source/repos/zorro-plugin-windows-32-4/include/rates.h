@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+namespace Rates {
+
+// Local currency-conversion graph
+// Assets are nodes, symbols are edges (baseAssetId <-> quoteAssetId). Build()
+// runs a BFS from depositAssetId and stores the shortest symbol path of every
+// asset. Each applied quote re-evaluates the assets whose path uses that
+// symbol, so a quote->deposit rate is always a single atomic load.
+
+constexpr int MAX_HOPS = 4;  // longest conversion path considered
+
+// Rebuild from the symbol table and G.depositAssetId (after login or symbol revalidation)
+void Build();
+
+// Units of deposit currency per 1 unit of the symbol's quote asset.
+// 0 if there is no path or a path symbol has no quote yet.
+double QuoteToDeposit(int handle);
+
+// True if the symbol's quote asset is connected to the deposit asset
+bool HasPath(int handle);
+
+// Handles of the symbols on the conversion path (to subscribe them)
+void PathSymbols(int handle, std::vector<int>& out);
+
+// Re-evaluate the rates that depend on this symbol (NetworkThread, after the quote is stored)
+void OnQuote(int handle, Price bid);
+
+// Drop all graphs (new session, threads stopped)
+void Reset();
+
+} // namespace Rates
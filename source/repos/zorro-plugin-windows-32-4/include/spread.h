@@ -0,0 +1,36 @@
+#pragma once
+
+struct T6;
+
+namespace Spread {
+
+// Recorded spread per bar
+// Trendbars are BID-only. Every full SpotEvent of a subscribed symbol is
+// aggregated into one-minute spread statistics (tick count, mean and max
+// spread) that are appended to History\{Symbol}_{year}.spr next to the bar
+// cache. Bars of any period are then stamped from the minutes they span
+// instead of with the current live spread.
+
+// Count one full quote (NetworkThread). rawBid/rawAsk in PRICE_SCALE units.
+void Record(int handle, long long serverMs, long long rawBid, long long rawAsk);
+
+// Close minutes that received no further quote (NetworkThread, every 60s)
+void Roll();
+
+// Append closed minutes to the .spr files (main thread). closeOpen also
+// writes the minutes still open (only with the NetworkThread stopped).
+void Flush(bool closeOpen = false);
+
+// Set fVal (mean spread) of bars (newest first, open time) from the recorded
+// minutes, and fVol (tick count) where the bar has no volume.
+// Returns number of bars with recorded data; the others are left unchanged.
+int Apply(const char* symbolName, int nTickMinutes, T6* bars, int count);
+
+// SET_SPREADSTATS: record on/off (default on)
+void Enable(bool on);
+bool IsEnabled();
+
+// Drop open minutes and unflushed records (new session, threads stopped)
+void Reset();
+
+} // namespace Spread
@@ -11,7 +11,9 @@
 #include <winhttp.h>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <vector>
+#include <atomic>
 
 #pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "winhttp.lib")
@@ -35,9 +37,86 @@ public:
     CsLock& operator=(const CsLock&) = delete;
 };
 
-// Symbol info from SymbolsListRes + SymbolByIdRes
+// Dense symbol handles: 0..MAX_SYMBOLS-1, assigned once per symbol name
+constexpr int MAX_SYMBOLS = 8192;
+
+// Fixed-point price: cTrader's integer price in units of 1/PRICE_UNITS.
+// Quotes, order prices, SL/TP and conversion inputs stay integers; only the
+// Zorro API boundary converts with PriceToDouble/PriceFromDouble.
+typedef long long Price;
+constexpr long long PRICE_UNITS = 100000;
+constexpr double PRICE_SCALE = (double)PRICE_UNITS;
+
+inline double PriceToDouble(Price p) { return (double)p / PRICE_SCALE; }
+
+// Nearest price unit (a plain cast of 1.23456 * 1e5 gives 123455)
+inline Price PriceFromDouble(double v) { return (Price)(v * PRICE_SCALE + (v < 0.0 ? -0.5 : 0.5)); }
+
+// Torn-free copy of a QuoteSlot
+struct Quote {
+    Price bid = 0;
+    Price ask = 0;
+    Price high = 0;                // bid range of the current UTC day
+    Price low = 0;
+    long long lastQuoteTime = 0;   // server timestamp (Unix ms)
+};
+
+// Hot per-symbol data: everything a tick changes, one cache line per symbol.
+// G.quotes is a contiguous array indexed by handle, so a tick touches one line
+// and a scan over many symbols streams through memory.
+// Single writer (NetworkThread, Feed::Post), any number of readers, no locks:
+// seq is odd while a write is in progress; readers retry until they
+// copy the fields between two identical even seq values.
+struct alignas(64) QuoteSlot {
+    std::atomic<unsigned> seq{0};
+    std::atomic<Price> bid{0};
+    std::atomic<Price> ask{0};
+    std::atomic<Price> high{0};
+    std::atomic<Price> low{0};
+    std::atomic<long long> lastQuoteTime{0};
+
+    void Store(Price b, Price a, Price h, Price l, long long ts) {
+        unsigned s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bid.store(b, std::memory_order_relaxed);
+        ask.store(a, std::memory_order_relaxed);
+        high.store(h, std::memory_order_relaxed);
+        low.store(l, std::memory_order_relaxed);
+        lastQuoteTime.store(ts, std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // Returns number of retries (0 = uncontended read)
+    int Load(Quote& out) const {
+        for (int retries = 0;; retries++) {
+            unsigned s0 = seq.load(std::memory_order_acquire);
+            if (s0 & 1) { YieldProcessor(); continue; }
+            out.bid = bid.load(std::memory_order_relaxed);
+            out.ask = ask.load(std::memory_order_relaxed);
+            out.high = high.load(std::memory_order_relaxed);
+            out.low = low.load(std::memory_order_relaxed);
+            out.lastQuoteTime = lastQuoteTime.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s0) return retries;
+        }
+    }
+
+    void Clear() { Store(0, 0, 0, 0, 0); }
+};
+
+// symbolId -> handle index entry (open addressing, insert-only)
+struct SymbolIdSlot {
+    std::atomic<long long> symbolId{0};  // 0 = empty
+    std::atomic<int> handle{-1};
+};
+
+// Symbol info from SymbolsListRes + SymbolByIdRes (cold metadata, G.symbols[handle])
+// bid/ask/high/low/lastQuoteTime are only a snapshot: Symbols::GetSymbol
+// fills them from the quote table, the stored copy leaves them at 0.
 struct SymbolInfo {
     long long symbolId = 0;
+    int handle = -1;              // dense index into G.quotes
     std::string name;
     int digits = 5;
     int pipPosition = 4;
@@ -50,15 +129,18 @@ struct SymbolInfo {
     int swapCalculationType = 0;  // 0=PIPS, 1=PERCENTAGE(annual), 2=POINTS
     long long commissionRaw = 0;  // raw commission from SymbolByIdRes (moneyDigits scaled)
     int commissionType = 0;       // 1=USD_PER_MIL_USD, 2=USD_PER_LOT, 3=PERCENTAGE, 4=QUOTE_CCY_PER_LOT
-    double bid = 0.0;
-    double ask = 0.0;
-    double high = 0.0;
-    double low = 0.0;
+    Price bid = 0;
+    Price ask = 0;
+    Price high = 0;
+    Price low = 0;
     long long baseAssetId = 0;
     long long quoteAssetId = 0;
     bool subscribed = false;
     long long lastQuoteTime = 0;
     double marginPerLot = 0.0;       // from ExpectedMarginRes: margin for volume=10000 (1 Zorro lot)
+    bool detailsLoaded = false;      // contract fields above came from SymbolByIdRes
+    bool detailsPending = false;     // queued or requested on first use (SET_LAZYDETAILS)
+    bool detailsDirty = false;       // contract changed while pending: request again when it lands
 };
 
 // Trade/position info
@@ -138,9 +220,19 @@ struct State {
     CRITICAL_SECTION csLog;
     CRITICAL_SECTION csWebSocket;
 
-    // Symbols - SINGLE source!
-    std::map<std::string, SymbolInfo> symbols;       // name -> info
-    std::map<long long, std::string> symbolIdToName;  // reverse lookup
+    // Symbols - SINGLE source! Indexed by dense handle (see QuoteSlot)
+    // Handles are never reused within a session, so a published handle stays valid.
+    std::vector<SymbolInfo> symbols;                     // cold metadata, guarded by csSymbols
+    QuoteSlot quotes[MAX_SYMBOLS];                       // hot quote data, lock-free
+
+    // symbolId -> handle (written under csSymbols, read lock-free)
+    static constexpr int SYMBOL_ID_INDEX_SIZE = 2 * MAX_SYMBOLS;  // power of two
+    SymbolIdSlot symbolIdIndex[SYMBOL_ID_INDEX_SIZE];
+
+    // Name resolution, built once per SymbolsListRes (guarded by csSymbols)
+    std::unordered_map<std::string, int> symbolHandles;  // exact cTrader name -> handle
+    std::unordered_map<std::string, int> symbolAliases;  // exact + normalized name -> handle
+    volatile LONG symbolGeneration = 0;                  // bumped when handles change (asset caches)
 
     // Trades
     std::map<int, TradeInfo> trades;                  // zorroId -> info
@@ -177,6 +269,7 @@ struct State {
     std::string currentSymbol;
     int orderType = 0;
     int waitTime = 30000;  // default 30s timeout
+    bool lazyDetails = false;  // SET_LAZYDETAILS: login loads the light symbol list only
     double lastPositionAvgEntry = 0.0;  // cached for GET_AVGENTRY (set by GET_POSITION)
 
     // Reconnect state
@@ -203,6 +296,9 @@ struct State {
     volatile bool waitingForMargin = false;
     volatile bool marginResponseReady = false;
     long long marginPendingSymbolId = 0;      // which symbol we sent ExpectedMarginReq for
+    std::string marginPendingMsgId;           // its clientMsgId, guarded by csSymbols
+    // Pipelined ExpectedMarginReq (DO_PREFETCH): clientMsgId -> symbolId, guarded by csSymbols
+    std::unordered_map<std::string, long long> marginPendingByMsgId;
 
     // Currency conversion chains (M9: SymbolsForConversionReq/Res 2118/2119)
     struct ConvChainEntry {
@@ -221,6 +317,21 @@ struct State {
     volatile bool conversionResponseReady = false;
     static constexpr int CONV_BUF_SIZE = 32 * 1024;  // 32KB
     char conversionResponseBuf[CONV_BUF_SIZE] = {};
+    // Pipelined SymbolsForConversionReq (DO_PREFETCH), guarded by csSymbols
+    struct ConvPending {
+        long long quoteAssetId = 0;
+        std::string response;   // raw SymbolsForConversionRes, parsed on the main thread
+        bool done = false;      // response (or error) arrived
+    };
+    std::unordered_map<std::string, ConvPending> conversionPending;  // clientMsgId -> request
+
+    // Contract details on first use (SET_LAZYDETAILS), guarded by csSymbols
+    struct DetailRequest {
+        std::vector<long long> symbolIds;
+        ULONGLONG sentMs = 0;
+    };
+    std::vector<long long> detailQueue;                                   // waiting for the next SymbolByIdReq
+    std::unordered_map<std::string, DetailRequest> detailPendingByMsgId;  // clientMsgId -> request
 
     // Subscription tracking
     int quoteCount = 0;
@@ -235,6 +346,27 @@ struct State {
     static constexpr int HIST_BUF_SIZE = 2 * 1024 * 1024;  // 2MB for M1 data
     char* historyResponseBuf = nullptr;  // heap-allocated in Init()
 
+    // Live trendbar rings (Bars module)
+    CRITICAL_SECTION csBars;
+
+    // Spot subscribe/unsubscribe requests in order (Subs module)
+    CRITICAL_SECTION csSubs;
+
+    // Closed spread minutes waiting for Flush (Spread module)
+    CRITICAL_SECTION csSpread;
+
+    // Indicator streams and values (Indicators module)
+    CRITICAL_SECTION csIndicators;
+
+    // Mapped history blocks (HistStore module)
+    CRITICAL_SECTION csHistStore;
+
+    // Decoded tick journal days (Journal module reader)
+    CRITICAL_SECTION csJournal;
+
+    // Rolling traffic windows (Stats module; the counters themselves are lock-free)
+    CRITICAL_SECTION csStats;
+
     // Trading response mechanism (NetworkThread forwards to BrokerBuy2/Sell2)
     CRITICAL_SECTION csTrading;
     volatile bool waitingForTrading = false;
@@ -255,7 +387,6 @@ constexpr const char* CTRADER_HOST_DEMO = "demo.ctraderapi.com";
 constexpr const char* CTRADER_HOST_LIVE = "live.ctraderapi.com";
 constexpr int CTRADER_WS_PORT = 5036;
 constexpr ULONGLONG PING_INTERVAL_MS = 10000;  // API: 10s heartbeat, 30s disconnect
-constexpr double PRICE_SCALE = 100000.0;
 
 typedef double DATE;
 
@@ -268,6 +399,13 @@ typedef struct T6 {
     float fOpen, fClose;   // (f3,f4) - 4+4 bytes
     float fVal, fVol;      // additional data: spread and volume (f5,f6) - 4+4 bytes
 } T6;  // = 32 bytes total
+
+// T2 order book quote (Zorro GET_BOOK)
+typedef struct T2 {
+    DATE  time;           // GMT timestamp
+    float fPrice;         // quote price, negative for bid quotes
+    float fVol;           // quote volume
+} T2;  // = 16 bytes total
 #pragma pack(pop)
 
 namespace StateInit {
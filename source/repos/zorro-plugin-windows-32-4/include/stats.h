@@ -0,0 +1,41 @@
+#pragma once
+
+struct TrafficStats;
+
+namespace Stats {
+
+// Per-payload-type traffic accounting
+// Counters are lock-free (Interlocked*), safe to update from any thread;
+// the rolling windows are guarded by G.csStats.
+
+// High-resolution timestamp (QueryPerformanceCounter ticks)
+long long Ticks();
+
+// Convert a tick delta to microseconds
+double TicksToUs(long long ticks);
+
+// Count an outbound message (called from WebSocket::Send after a successful send)
+void RecordSend(int payloadType, int bytes);
+
+// Count an inbound message (called by each WebSocket::Receive caller once it parsed the type)
+void RecordReceive(int payloadType, int bytes);
+
+// Record receive-to-dispatch time for one message (NetworkThread): from the end
+// of WebSocket::Receive until its handler returned. Messages are handled one at
+// a time, so this includes the handler and is the wait it imposes on the next one.
+void RecordDispatch(int payloadType, long long recvTicks);
+
+// Close the current rolling window and start a new one (NetworkThread, every 60s)
+void Roll();
+
+// Fill a snapshot of the last completed window (current partial window if none yet)
+// out->payloadType selects one PayloadType, 0 = totals over all types
+bool GetSnapshot(TrafficStats* out);
+
+// Write the last completed window to the log (totals + busiest payload types)
+void LogSnapshot();
+
+// Clear all counters (new session)
+void Reset();
+
+} // namespace Stats
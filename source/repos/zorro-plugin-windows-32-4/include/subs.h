@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace Subs {
+
+// Spot subscription manager
+// A symbol stays subscribed while any consumer holds it:
+//   SUB_ASSET       lease, renewed by every BrokerAsset / DO_PREFETCH use
+//   SUB_CONVERSION  lease, renewed with every asset whose quote->deposit path uses the symbol
+//   SUB_POSITION    open positions on the symbol (PnL, close price) or whose
+//                   quote->deposit path uses it
+//   SUB_BARS        live trendbar streams (they ride on SpotEvents)
+//   SUB_INDICATORS  indicator streams (bars built from the quotes)
+// Sweep() unsubscribes symbols without positions or bar streams whose leases
+// are older than the idle timeout, all in one UnsubscribeSpotsReq.
+// Subscribe/unsubscribe requests are serialized by G.csSubs, so a symbol
+// used again during a sweep can never end up unsubscribed.
+
+enum Consumer { SUB_ASSET, SUB_CONVERSION, SUB_POSITION, SUB_BARS, SUB_INDICATORS, SUB_CONSUMERS };
+
+constexpr int DEFAULT_IDLE_SEC = 900;
+
+// Renew the leases of the assets and their conversion legs and subscribe
+// those that are not subscribed yet with one SubscribeSpotsReq (Zorro thread).
+// Returns the number of listed assets subscribed by this call.
+int UseMany(const std::vector<std::string>& names);
+
+// Same by symbol handle (GET_ASSETSNAPSHOT, no name lookups)
+int UseHandles(const std::vector<int>& handles);
+
+// Single asset; true if it was subscribed by this call (its last quote may be stale)
+bool Use(const char* name);
+
+// Lease length in seconds, 0 = never unsubscribe (SET_SUBIDLE)
+void SetIdleTimeout(int seconds);
+
+// Unsubscribe idle symbols (NetworkThread, every 60s)
+void Sweep();
+
+// After reconnect: one SubscribeSpotsReq for every symbol still held or leased
+void Resubscribe();
+
+// Forget all leases (new session)
+void Reset();
+
+} // namespace Subs
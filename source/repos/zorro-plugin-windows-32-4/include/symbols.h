@@ -1,31 +1,84 @@
 #pragma once
 #include <string>
+#include <vector>
 
 namespace Symbols {
 
 // Request and process the full symbol list
 bool RequestSymbolList();
 
+// Fill the symbol table from a snapshot (SymCache), keeping existing handles
+void RestoreSymbols(const std::vector<SymbolInfo>& cached);
+
 // Request detailed info for symbols by ID (batched)
 bool RequestSymbolDetails();
 
 // Subscribe to spot quotes for a symbol
 bool Subscribe(const char* symbolName);
 
-// Batch resubscribe all previously subscribed symbols
-void BatchResubscribe();
+// Subscribe many symbols with one SubscribeSpotsReq (no delay).
+// Returns the number of symbols that were not subscribed before.
+int SubscribeMany(const std::vector<std::string>& names);
+
+// Unsubscribe many symbols with one UnsubscribeSpotsReq (Subs::Sweep).
+// Returns the number of symbols that were subscribed.
+int UnsubscribeMany(const std::vector<int>& handles);
+
+// Process incoming SpotEvent (NetworkThread): journal, live bars, then Feed::Post
+void HandleSpotEvent(const char* buffer, long long recvTicks);
 
-// Process incoming SpotEvent
-void HandleSpotEvent(const char* buffer);
+// Write one quote to the quote table (NetworkThread, via Feed::Post).
+void ApplyQuote(int handle, long long rawBid, long long rawAsk, long long ts);
 
-// Process SymbolsListRes
-void HandleSymbolsListRes(const char* buffer);
+// Process SymbolsListRes; returns the number of symbols new to the table.
+// prune: the list is authoritative, drop symbols it no longer contains
+// (their handles stay allocated but resolve to nothing).
+int HandleSymbolsListRes(const char* buffer, bool prune = false);
 
 // Process SymbolByIdRes
-void HandleSymbolByIdRes(const char* buffer);
+// Returns false if it answered an on-demand request (EnsureDetails)
+bool HandleSymbolByIdRes(const char* buffer);
+
+// Contract details on first use: one SymbolByIdReq for all listed symbols
+// without details, batched with concurrent first uses (NetworkThread must run).
+// True if every known listed symbol has its details.
+bool EnsureDetails(const std::vector<std::string>& names);
+bool EnsureDetails(const char* name);
+
+// Send queued detail requests unless one is still outstanding (any thread)
+void FlushDetailQueue();
+
+// SymbolChangedEvent (NetworkThread): drop margin per lot of the listed symbols,
+// re-request their details pipelined and fetch the light list for new symbolIds
+void HandleSymbolChangedEvent(const char* buffer);
+
+// Number of symbols with contract details loaded (GET_DETAILCOUNT)
+int DetailsLoadedCount();
 
 // Process ExpectedMarginRes (M7: per-symbol margin)
-void HandleExpectedMarginRes(const char* buffer);
+// Returns false unless it answered BrokerAsset's request (pipelined or late)
+bool HandleExpectedMarginRes(const char* buffer);
+
+// Pipelined requests for DO_PREFETCH, matched to responses by clientMsgId.
+// Return the clientMsgId, "" if the send failed.
+std::string RequestMarginAsync(long long symbolId, long long volume);
+std::string RequestConversionChainAsync(long long quoteAssetId);
+
+// True while a pipelined request has no response or error yet
+bool IsRequestPending(const std::string& msgId);
+
+// Stop tracking pipelined margin requests that timed out; a late response is ignored
+void CancelMarginRequests(const std::vector<std::string>& msgIds);
+
+// ErrorRes for a pipelined request: stop waiting for it (NetworkThread)
+void HandleRequestError(const char* buffer);
+
+// Cross pair whose quote->deposit chain is not loaded yet (main thread)
+bool NeedsConversionChain(const SymbolInfo& sym);
+
+// Parse finished pipelined chains (main thread). Chain symbols that still
+// need a subscription are appended to chainSymbols.
+void CompleteConversionChains(std::vector<std::string>& chainSymbols);
 
 // M9: Currency conversion chain (SymbolsForConversionReq/Res 2118/2119)
 // Get quoteToDeposit rate for a symbol. Lazy-loads chain from server on first call.
@@ -37,7 +90,24 @@ void HandleSymbolsForConversionRes(const char* buffer);
 // Lookup symbol by name (thread-safe)
 bool GetSymbol(const char* name, SymbolInfo& out);
 
+// Dense handle for a Zorro or cTrader symbol name, -1 if unknown
+// Repeated names are served from a per-thread cache without locking.
+int GetHandle(const char* name);
+
 // Lookup symbol name by ID
 const char* GetNameById(long long symbolId);
 
+// Live quote table (lock-free, see QuoteSlot in state.h)
+// Dense handle for a symbolId, -1 if unknown
+int GetHandleById(long long symbolId);
+
+// Quote table version of a handle, changes with every stored quote
+unsigned QuoteSeq(int handle);
+
+// Consistent bid/ask/time for a handle (false if handle is invalid)
+bool GetQuote(int handle, Quote& out);
+
+// Drop all symbols, handles and quotes (new session, NetworkThread stopped)
+void ClearSymbols();
+
 } // namespace Symbols
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace SymCache {
+
+// Per-account symbol snapshot for warm login
+// {dllDir}cTrader_symbols_{accountId}.bin holds the symbol table, contract
+// details, margin per lot, conversion chains and account leverage/deposit
+// asset. A warm BrokerLogin loads it instead of SymbolsListReq + batched
+// SymbolByIdReq + TraderReq, and Revalidate() refreshes everything through
+// the NetworkThread afterwards.
+
+// Load the snapshot of G.accountId into the (empty) symbol table (main thread).
+// False if missing, from another version/environment or corrupt.
+bool Load();
+
+// Write the current state to the snapshot (main thread; temp file + rename)
+void Save();
+
+// Send SymbolsListReq and TraderReq; the NetworkThread handles the responses
+// and requests all contract details in pipelined batches (NetworkThread must run)
+void Revalidate();
+
+// NetworkThread hooks for the revalidation responses. Only replies to the
+// revalidation's own SymbolByIdReq batches (by clientMsgId) are counted;
+// an ErrorRes to a batch counts as answered.
+void OnSymbolList();
+void OnSymbolDetails(const char* buffer);
+void OnRequestError(const char* buffer);
+
+// True while a revalidation is in progress
+bool IsRevalidating();
+
+} // namespace SymCache
@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct SymbolInfo;
+
+namespace SymTable {
+
+// Read-copy-update view of the symbol table
+// G.symbols stays the writers' master copy under csSymbols. After a change
+// the writer publishes immutable copies of the touched records in a new
+// versioned Table and swaps it in with one atomic store; readers (GetSymbol,
+// GetHandle) never take csSymbols. Records are grouped in pages that are
+// copied on write, so publishing one record copies one page, not the table.
+// Replaced tables, pages, records and name maps are freed by epoch-based
+// reclamation once no reader can still hold them.
+
+constexpr int PAGE_SIZE = 64;  // records per page
+
+struct Page {
+    const SymbolInfo* recs[PAGE_SIZE] = {};  // immutable
+};
+
+struct Table {
+    long long version = 0;
+    int count = 0;                                           // handles
+    std::vector<const Page*> pages;
+    const std::unordered_map<std::string, int>* names = nullptr;  // exact + normalized name -> handle
+
+    const SymbolInfo* Find(int handle) const {
+        return (handle >= 0 && handle < count) ? pages[handle / PAGE_SIZE]->recs[handle % PAGE_SIZE] : nullptr;
+    }
+};
+
+// Pins the current table for the reader's scope (nestable, any thread).
+// Threads beyond the reader slots fall back to holding csSymbols.
+class Reader {
+public:
+    Reader();
+    ~Reader();
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    const Table& operator*() const { return *m_table; }
+    const Table* operator->() const { return m_table; }
+
+private:
+    const Table* m_table;
+    bool m_locked;
+};
+
+// Give the calling thread's reader slot back (end of a thread that used
+// Readers; the NetworkThread and the Journal recorder are recreated per login)
+void ReleaseThread();
+
+// Free an object swapped out of another lock-free structure (Rates graph) once
+// no Reader that could have loaded it is left. Swap first, then retire.
+// Caller holds csSymbols.
+void RetireLocked(void (*free)(const void*), const void* p);
+
+// Publish the current G.symbols records of these handles, and G.symbolAliases
+// when names changed, in one version (caller holds csSymbols)
+void PublishLocked(const std::vector<int>& handles, bool names = false);
+void PublishLocked(int handle);
+
+// Publish every record and G.symbolAliases (caller holds csSymbols).
+// For whole-table changes only: reset, reconnect, leverage change.
+void PublishAllLocked();
+
+// Version of the published table (0 = nothing published yet)
+long long Version();
+
+// Free all versions (new session, threads stopped)
+void Reset();
+
+} // namespace SymTable
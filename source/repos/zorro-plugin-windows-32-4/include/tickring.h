@@ -0,0 +1,39 @@
+#pragma once
+
+struct T6;
+
+namespace TickRing {
+
+// Recent ticks per symbol
+// HandleSpotEvent pushes every full quote (bid, ask, server time) into a
+// fixed ring of the symbol, allocated on its first SpotEvent and retired
+// through the symbol table's epochs once the symbol is unsubscribed. One
+// writer (NetworkThread), lock-free readers: a reader copies newest first and
+// drops whatever the writer overwrote meanwhile. Tick-history requests that end
+// inside the ring are answered from memory; only the older part is downloaded.
+
+constexpr int RING_TICKS = 4096;  // ticks kept per symbol
+
+// Append one full quote (NetworkThread). rawBid/rawAsk in PRICE_SCALE units.
+void Push(int handle, long long serverMs, long long rawBid, long long rawAsk);
+
+// The streams were interrupted (reconnect): ticks before the break no
+// longer run up to "now"
+void BreakAll();
+
+// Drop the ring of an unsubscribed symbol (NetworkThread, caller holds csSymbols).
+// Freed once no Read can still hold it.
+void ReleaseLocked(int handle);
+
+// Ticks of [startMs, endMs] as Zorro T6 (fClose = bid, fVal = spread, fVol = 1),
+// newest first. live = symbol subscribed and connected, so the ring runs up to
+// now. Returns 0 unless the ring covers the end of the range; otherwise
+// *uncoveredEndMs receives the end of the older part the ring does not cover
+// (< startMs when the whole range was served).
+int Read(int handle, bool live, long long startMs, long long endMs, int maxTicks,
+         T6* out, long long* uncoveredEndMs);
+
+// Free all rings (new session, threads stopped)
+void Reset();
+
+} // namespace TickRing
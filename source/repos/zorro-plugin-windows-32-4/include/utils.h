@@ -23,4 +23,8 @@ bool ContainsCI(const char* haystack, const char* needle);
 // Get current time in ms
 ULONGLONG NowMs();
 
+// UTC wall clock as Unix time; the microsecond clock is the precise one (latency stamps)
+long long NowUnixMs();
+long long NowUnixUs();
+
 } // namespace Utils
@@ -4,7 +4,9 @@ namespace WebSocket {
 
 bool Connect(const char* host, int port);
 void Disconnect();
-bool Send(const char* message);
+// payloadType: the type the caller built the message with (traffic accounting)
+bool Send(const char* message, int payloadType);
+// Callers count what they receive with Stats::RecordReceive once they parsed the type
 int Receive(char* buffer, int bufferSize);
 bool IsConnected();
 
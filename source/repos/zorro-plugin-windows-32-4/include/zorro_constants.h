@@ -6,6 +6,7 @@
 #define GET_TIME            5
 #define GET_DIGITS          12
 #define GET_STOPLEVEL       14
+#define GET_BOOK            17
 #define GET_TRADEALLOWED    22
 #define GET_MINLOT          23
 #define GET_LOTSTEP         24
@@ -64,11 +65,96 @@
 #define SET_TAKEPROFIT      2002  // *(double*)dwParameter = TP price (0 = remove)
 #define DO_MODIFY_SLTP      2003  // dwParameter = tradeId -> send AmendPositionSltpReq
 
+// Custom plugin commands (diagnostics)
+#define GET_TRAFFIC         2004  // dwParameter = TrafficStats* -> returns inbound msgs/sec
+#define DO_BENCHMARK        2005  // dwParameter = BENCH_* id -> logs results, returns primary metric
+#define SET_TICKJOURNAL     2006  // dwParameter = 1 record live quotes to History\Ticks, 0 = stop
+#define DO_PREFETCH         2008  // dwParameter = char* asset list ("EUR/USD,GBP/USD,...") -> returns assets warmed
+#define SET_LAZYDETAILS     2009  // dwParameter = 1 load contract details on first use (takes effect at login)
+#define GET_DETAILCOUNT     2010  // returns number of symbols with contract details loaded
+#define GET_QUOTESTATS      2011  // dwParameter = QuoteStats* -> returns ms since the symbol's last quote
+#define SET_SUBIDLE         2012  // dwParameter = seconds unused before a spot subscription is dropped (0 = never, default 900)
+#define SET_SPREADSTATS     2013  // dwParameter = 1 record per-minute spreads to History\*.spr (default), 0 = stop
+#define SET_INDICATOR       2014  // dwParameter = IndicatorDef* -> returns indicator id (1..), 0 = invalid
+#define GET_INDICATORS      2015  // dwParameter = double[number of indicators], value of id n at [n-1] -> returns number of values; NULL -> number of indicators
+#define GET_ASSETHANDLE     2016  // dwParameter = char* asset -> warms it like BrokerAsset, returns handle (-1 = unknown)
+#define GET_ASSETSNAPSHOT   2017  // dwParameter = AssetSnapshot* -> returns number of assets with a quote
+
+// DO_BENCHMARK ids (scratch data only, never touches live state)
+#define BENCH_QUOTES        1     // quote table: 1 writer vs N readers, seqlock vs critical section
+#define BENCH_BOOK          2     // order book: DepthEvent-style updates + snapshot publish
+
 // Trade flags (from Zorro trading.h)
 #define TR_LONG     0
 #define TR_SHORT    1             // short position
 #define TR_OPEN     (1<<1)        // position is open (=2)
 
+// GET_TRAFFIC result: per-payload-type link usage over the last 60s window
+// Caller sets payloadType (0 = all types), plugin fills the rest.
+struct TrafficStats {
+    int     payloadType;          // in: PayloadType to report, 0 = totals
+    int     windowSec;            // window length in seconds
+    double  msgsIn, msgsOut;      // messages in window
+    double  bytesIn, bytesOut;    // bytes in window
+    double  msgsInPerSec, msgsOutPerSec;
+    double  bytesInPerSec, bytesOutPerSec;
+    double  maxMsgBytes;          // largest single message in window
+    double  avgDispatchUs;        // receive -> handler done, average
+    double  maxDispatchUs;        // receive -> handler done, worst case
+};
+
+// GET_QUOTESTATS result: per-symbol quote freshness since login
+// Caller sets symbol, plugin fills the rest. Histogram bucket 0 = below 1 ms,
+// bucket k = [2^(k-1), 2^k) ms, last bucket open ended. Percentiles are bucket upper bounds.
+#define QUOTE_HIST_BUCKETS  20
+struct QuoteStats {
+    char    symbol[32];           // in: asset name
+    double  quotes;               // SpotEvents received
+    double  quotesPerSec;         // over the last 60s window (since login until the first one closes)
+    double  ageMs;                // since the last SpotEvent, -1 = none yet
+    double  gapP50Ms, gapP99Ms;   // time between SpotEvents
+    double  gapMaxMs;
+    double  latencyAvgMs;         // SpotEvent timestamp -> local receive, includes clock offset
+    double  latencyMinMs;         // best case, approximates the clock offset
+    double  latencyP50Ms, latencyP99Ms;
+    int     gapHist[QUOTE_HIST_BUCKETS];
+    int     latencyHist[QUOTE_HIST_BUCKETS];  // negative latencies count as bucket 0
+};
+
+// SET_INDICATOR definition: rolling indicator over the closed BID bars of
+// (symbol, minutes). minutes must divide a day (1440). Values stay 0 until
+// length bars have closed; the same definition twice returns the same id.
+#define IND_EMA             1     // exponential moving average of closes, alpha = 2/(length+1)
+#define IND_SMA             2     // simple moving average of closes
+#define IND_VARIANCE        3     // sample variance of close-to-close returns (length >= 2)
+#define IND_ATR             4     // average true range, Wilder smoothing
+#define IND_MIN             5     // lowest low
+#define IND_MAX             6     // highest high
+struct IndicatorDef {
+    char    symbol[32];           // asset name
+    int     minutes;              // bar period
+    int     type;                 // IND_*
+    int     length;               // bars, 1..1024
+};
+
+// GET_ASSETSNAPSHOT: BrokerAsset values of many assets in one call.
+// Quotes come from one quote-table pass; per-lot values as in BrokerAsset.
+struct AssetQuote {
+    int     handle;               // in: from GET_ASSETHANDLE
+    int     valid;                // out: 1 = quote available
+    double  price;                // ask (bid if no ask)
+    double  spread;
+    double  pipCost;              // account currency per pip and lot
+    double  marginCost;           // per lot
+    double  rollLong, rollShort;  // per lot and day
+    double  commission;           // as BrokerAsset pVolume
+    double  quoteTime;            // server time of the quote (OLE DATE, UTC)
+};
+struct AssetSnapshot {
+    int         count;            // entries in assets
+    AssetQuote* assets;
+};
+
 // Zorro TRADE struct - MUST match Zorro's trading.h layout exactly (32-bit, default MSVC alignment)
 // Used for GET_TRADES command. Plugin fills nID, nLots, flags, fEntryPrice.
 // All other fields zeroed.
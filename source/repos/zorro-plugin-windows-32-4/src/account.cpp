@@ -2,8 +2,10 @@
 #include "../include/account.h"
 #include "../include/protocol.h"
 #include "../include/websocket.h"
+#include "../include/stats.h"
 #include "../include/logger.h"
 #include "../include/utils.h"
+#include "../include/symtable.h"
 #include <cstdio>
 #include <cmath>
 
@@ -15,7 +17,7 @@ bool RequestTraderInfo() {
 
     const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
                                              PayloadType::TraderReq, payload);
-    if (!WebSocket::Send(msg)) return false;
+    if (!WebSocket::Send(msg, ToInt(PayloadType::TraderReq))) return false;
 
     char response[16384] = {0};
     ULONGLONG start = Utils::NowMs();
@@ -23,6 +25,7 @@ bool RequestTraderInfo() {
         int n = WebSocket::Receive(response, sizeof(response));
         if (n > 0) {
             int pt = Protocol::ExtractPayloadType(response);
+            Stats::RecordReceive(pt, n);
             if (pt == ToInt(PayloadType::TraderRes)) {
                 HandleTraderRes(response);
                 return true;
@@ -59,6 +62,14 @@ void HandleTraderRes(const char* buffer) {
     // Account leverage (e.g. 50000 = 500:1)
     long long lev = Protocol::ExtractInt64(trader, "leverageInCents");
     if (lev > 0) {
+        // Margin per lot depends on leverage: drop cached values (snapshot or previous session)
+        if (G.leverageInCents > 0 && lev != G.leverageInCents) {
+            CsLock lock(G.csSymbols);
+            for (auto& sym : G.symbols) sym.marginPerLot = 0.0;
+            SymTable::PublishAllLocked();
+            Log::Info("ACC", "Leverage changed (%lld -> %lld), margin per lot will be reloaded",
+                      G.leverageInCents, lev);
+        }
         G.leverageInCents = lev;
     }
 
@@ -130,7 +141,7 @@ bool RefreshAccountInfo() {
     G.accountResponseReady = false;
     G.waitingForAccount = true;
 
-    if (!WebSocket::Send(msg)) {
+    if (!WebSocket::Send(msg, ToInt(PayloadType::TraderReq))) {
         G.waitingForAccount = false;
         Log::Warn("ACC", "RefreshAccountInfo send failed");
         return false;
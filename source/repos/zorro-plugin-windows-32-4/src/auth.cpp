@@ -2,6 +2,7 @@
 #include "../include/auth.h"
 #include "../include/protocol.h"
 #include "../include/websocket.h"
+#include "../include/stats.h"
 #include "../include/logger.h"
 #include "../include/utils.h"
 #include <cstdio>
@@ -40,7 +41,7 @@ bool ApplicationAuth() {
 
     const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
                                              PayloadType::ApplicationAuthReq, payload);
-    if (!WebSocket::Send(msg)) return false;
+    if (!WebSocket::Send(msg, ToInt(PayloadType::ApplicationAuthReq))) return false;
 
     char response[8192] = {0};
     ULONGLONG start = Utils::NowMs();
@@ -48,6 +49,7 @@ bool ApplicationAuth() {
         int n = WebSocket::Receive(response, sizeof(response));
         if (n > 0) {
             int pt = Protocol::ExtractPayloadType(response);
+            Stats::RecordReceive(pt, n);
             if (pt == ToInt(PayloadType::ApplicationAuthRes)) {
                 Log::Info("AUTH", "Application authenticated");
                 return true;
@@ -72,7 +74,7 @@ bool AccountAuth() {
 
     const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
                                              PayloadType::AccountAuthReq, payload);
-    if (!WebSocket::Send(msg)) return false;
+    if (!WebSocket::Send(msg, ToInt(PayloadType::AccountAuthReq))) return false;
 
     char response[8192] = {0};
     ULONGLONG start = Utils::NowMs();
@@ -80,6 +82,7 @@ bool AccountAuth() {
         int n = WebSocket::Receive(response, sizeof(response));
         if (n > 0) {
             int pt = Protocol::ExtractPayloadType(response);
+            Stats::RecordReceive(pt, n);
             if (pt == ToInt(PayloadType::AccountAuthRes)) {
                 Log::Info("AUTH", "Account %lld authenticated", G.accountId);
                 return true;
@@ -295,7 +298,7 @@ bool FetchAccountsList(std::vector<long long>& accountIds) {
 
     const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
                                              PayloadType::GetAccountsByAccessTokenReq, payload);
-    if (!WebSocket::Send(msg)) return false;
+    if (!WebSocket::Send(msg, ToInt(PayloadType::GetAccountsByAccessTokenReq))) return false;
 
     char response[32768] = {0};
     ULONGLONG start = Utils::NowMs();
@@ -303,6 +306,7 @@ bool FetchAccountsList(std::vector<long long>& accountIds) {
         int n = WebSocket::Receive(response, sizeof(response));
         if (n > 0) {
             int pt = Protocol::ExtractPayloadType(response);
+            Stats::RecordReceive(pt, n);
             if (pt == ToInt(PayloadType::GetAccountsByAccessTokenRes)) {
                 // Parse ctidTraderAccount array
                 const char* arr = Protocol::ExtractArray(response, "ctidTraderAccount");
@@ -0,0 +1,238 @@
+#include "../include/state.h"
+#include "../include/bars.h"
+#include "../include/symbols.h"
+#include "../include/protocol.h"
+#include "../include/websocket.h"
+#include "../include/logger.h"
+#include "../include/utils.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace Bars {
+
+// ============================================================
+// Bar ring per (symbol handle, period), guarded by G.csBars
+// Circular, ascending by bar open minute. The newest bar is the
+// in-progress bar and is updated in place until its minute changes.
+// ============================================================
+
+struct BarRing {
+    std::string name;               // cTrader symbol name
+    long long symbolId = 0;
+    int period = 0;                 // TrendbarPeriod
+    int minutes = 0;                // Zorro nTickMinutes
+    bool subscribed = false;        // SubscribeLiveTrendbarReq sent
+    bool live = false;              // contiguous up to now since the last seed
+    std::vector<long long> openMin; // bar open time, Unix minutes
+    std::vector<T6> bars;
+    int head = 0;                   // oldest bar
+    int count = 0;
+
+    BarRing() : openMin(RING_BARS), bars(RING_BARS) {}
+
+    int Index(int i) const { return (head + i) % RING_BARS; }  // i = 0 oldest
+    int Newest() const { return Index(count - 1); }
+
+    void Push(long long minute, const T6& bar) {
+        if (count > 0) {
+            int n = Newest();
+            if (minute == openMin[n]) { bars[n] = bar; return; }
+            if (minute < openMin[n]) return;  // late update for a closed bar
+        }
+        int slot;
+        if (count < RING_BARS) {
+            slot = Index(count);
+            count++;
+        } else {
+            slot = head;
+            head = (head + 1) % RING_BARS;
+        }
+        openMin[slot] = minute;
+        bars[slot] = bar;
+    }
+};
+
+static std::map<std::pair<int, int>, BarRing*> s_rings;  // (handle, period) -> ring
+static volatile bool s_anyLive = false;
+
+static long long OleToMinutes(DATE t) {
+    return (Utils::OleToUnix(t) + 30000) / 60000;  // round: OLE doubles are not exact
+}
+
+static bool SendLiveTrendbarSubscribe(long long symbolId, int period) {
+    char payload[256];
+    sprintf_s(payload, "\"ctidTraderAccountId\":%lld,\"period\":%d,\"symbolId\":%lld",
+              G.accountId, period, symbolId);
+    const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
+                                             PayloadType::SubscribeLiveTrendbarReq, payload);
+    return WebSocket::Send(msg, ToInt(PayloadType::SubscribeLiveTrendbarReq));
+}
+
+void Seed(const char* symbolName, int nTickMinutes, int period, const T6* bars, int count) {
+    if (!symbolName || !bars || count <= 0 || nTickMinutes <= 0) return;
+
+    // Only a download that reaches the present can be continued by live bars
+    long long newestMin = OleToMinutes(bars[0].time);
+    if (newestMin < Utils::NowUnixMs() / 60000 - 2LL * nTickMinutes) return;
+
+    SymbolInfo sym;
+    if (!Symbols::GetSymbol(symbolName, sym) || sym.handle < 0) return;
+
+    // Live trendbars arrive inside SpotEvents: spots must be subscribed
+    Symbols::Subscribe(symbolName);
+
+    bool needSubscribe = false;
+    {
+        CsLock lock(G.csBars);
+        BarRing*& ring = s_rings[std::make_pair(sym.handle, period)];
+        if (!ring) ring = new BarRing();
+        ring->name = sym.name;
+        ring->symbolId = sym.symbolId;
+        ring->period = period;
+        ring->minutes = nTickMinutes;
+
+        // Replace contents with the newest RING_BARS bars, oldest first
+        ring->head = 0;
+        ring->count = 0;
+        int n = (count < RING_BARS) ? count : RING_BARS;
+        for (int i = n - 1; i >= 0; i--) {
+            ring->Push(OleToMinutes(bars[i].time), bars[i]);
+        }
+        ring->live = true;
+        needSubscribe = !ring->subscribed;
+        ring->subscribed = true;
+    }
+
+    if (needSubscribe) {
+        if (SendLiveTrendbarSubscribe(sym.symbolId, period)) {
+            s_anyLive = true;
+            Log::Info("BARS", "Live trendbars subscribed: %s M%d (%d bars seeded)",
+                      sym.name.c_str(), nTickMinutes, count < RING_BARS ? count : RING_BARS);
+        } else {
+            CsLock lock(G.csBars);
+            auto it = s_rings.find(std::make_pair(sym.handle, period));
+            if (it != s_rings.end()) it->second->subscribed = it->second->live = false;
+        }
+    }
+}
+
+int Read(const char* symbolName, DATE tStart, DATE tEnd, int nTickMinutes, int nTicks, T6* out) {
+    if (!s_anyLive || !symbolName || !out || nTicks <= 0) return 0;
+
+    int handle = Symbols::GetHandle(symbolName);
+    if (handle < 0) return 0;
+
+    CsLock lock(G.csBars);
+    for (auto& kv : s_rings) {
+        BarRing* ring = kv.second;
+        if (kv.first.first != handle || ring->minutes != nTickMinutes) continue;
+        if (!ring->live || ring->count == 0) return 0;
+
+        int n = 0;
+        for (int i = ring->count - 1; i >= 0 && n < nTicks; i--) {
+            const T6& bar = ring->bars[ring->Index(i)];
+            if (bar.time > tEnd) continue;
+            if (bar.time < tStart) break;
+            out[n++] = bar;
+        }
+
+        // Covered if the request is filled or the ring reaches back to tStart
+        const T6& oldest = ring->bars[ring->Index(0)];
+        if (n > 0 && (n >= nTicks || oldest.time <= tStart)) return n;
+        return 0;
+    }
+    return 0;
+}
+
+bool AnyLive() {
+    return s_anyLive;
+}
+
+// Period may come as enum number or name ("M1", "H4", ...)
+static int ParsePeriod(const char* elem) {
+    int period = Protocol::ExtractInt(elem, "period");
+    if (period > 0) return period;
+
+    static const char* names[] = { "", "M1", "M2", "M3", "M4", "M5", "M10", "M15", "M30",
+                                   "H1", "H4", "H12", "D1", "W1", "MN1" };
+    const char* s = Protocol::ExtractString(elem, "period");
+    for (int i = 1; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(s, names[i]) == 0) return i;
+    }
+    return 0;
+}
+
+void HandleSpotTrendbars(long long symbolId, const char* buffer, double bid, double ask) {
+    int handle = Symbols::GetHandleById(symbolId);
+    if (handle < 0) return;
+
+    const char* arr = Protocol::ExtractArray(buffer, "trendbar");
+    int count = Protocol::CountArrayElements(arr);
+    if (count <= 0) return;
+
+    float spread = (bid > 0.0 && ask > bid) ? (float)(ask - bid) : 0.0f;
+
+    CsLock lock(G.csBars);
+    for (int i = 0; i < count; i++) {
+        const char* elem = Protocol::GetArrayElement(arr, i);
+        if (!elem || !*elem) continue;
+
+        auto it = s_rings.find(std::make_pair(handle, ParsePeriod(elem)));
+        if (it == s_rings.end()) continue;
+
+        // Same delta encoding as GetTrendbarsRes: low absolute, others relative
+        long long low = Protocol::ExtractInt64(elem, "low");
+        long long tsMinutes = Protocol::ExtractInt64(elem, "utcTimestampInMinutes");
+        if (low <= 0 || tsMinutes <= 0) continue;
+
+        T6 bar;
+        memset(&bar, 0, sizeof(T6));
+        bar.fLow   = (float)PriceToDouble(low);
+        bar.fHigh  = (float)PriceToDouble(low + Protocol::ExtractInt64(elem, "deltaHigh"));
+        bar.fOpen  = (float)PriceToDouble(low + Protocol::ExtractInt64(elem, "deltaOpen"));
+        bar.fClose = (float)PriceToDouble(low + Protocol::ExtractInt64(elem, "deltaClose"));
+        bar.fVol   = (float)Protocol::ExtractInt64(elem, "volume");
+        bar.fVal   = spread;
+        bar.time   = Utils::MinutesToOle(tsMinutes);
+        it->second->Push(tsMinutes, bar);
+    }
+}
+
+void BatchResubscribe() {
+    std::vector<std::pair<std::string, std::pair<long long, int>>> toSub;
+    {
+        CsLock lock(G.csBars);
+        for (auto& kv : s_rings) {
+            BarRing* ring = kv.second;
+            ring->live = false;  // bars may be missing: next BrokerHistory2 reseeds
+            if (ring->subscribed)
+                toSub.push_back({ ring->name, { ring->symbolId, ring->period } });
+        }
+    }
+
+    for (auto& s : toSub) {
+        Symbols::Subscribe(s.first.c_str());
+        SendLiveTrendbarSubscribe(s.second.first, s.second.second);
+    }
+    if (!toSub.empty())
+        Log::Info("BARS", "Resubscribed %d live trendbar streams", (int)toSub.size());
+}
+
+void CountLive(std::vector<int>& refs) {
+    CsLock lock(G.csBars);
+    for (const auto& kv : s_rings) {
+        int handle = kv.first.first;
+        if (kv.second->subscribed && handle >= 0 && handle < (int)refs.size()) refs[handle]++;
+    }
+}
+
+void Reset() {
+    CsLock lock(G.csBars);
+    for (auto& kv : s_rings) delete kv.second;
+    s_rings.clear();
+    s_anyLive = false;
+}
+
+} // namespace Bars
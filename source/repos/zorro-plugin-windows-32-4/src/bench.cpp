@@ -0,0 +1,221 @@
+#include "../include/state.h"
+#include "../include/bench.h"
+#include "../include/book.h"
+#include "../include/stats.h"
+#include "../include/logger.h"
+#include "../include/zorro_constants.h"
+#include <cstdio>
+#include <cstring>
+#include <process.h>
+
+namespace Bench {
+
+// ============================================================
+// BENCH_QUOTES: quote table under a spot storm
+// One writer updates quotes as fast as it can (NetworkThread role),
+// N readers poll random symbols (BrokerAsset / trading role).
+// Runs the seqlock QuoteSlot and the old CRITICAL_SECTION scheme
+// on the same workload and checks every read for torn values.
+// ============================================================
+
+static constexpr int QB_SYMBOLS = 64;
+static constexpr int QB_READERS = 3;
+static constexpr int QB_DURATION_MS = 1000;
+
+// Old scheme: plain fields guarded by one lock for all symbols
+struct LockedQuote {
+    double bid, ask, high, low;
+    long long lastQuoteTime;
+};
+
+struct QuoteBench {
+    bool useLock = false;
+    QuoteSlot* slots = nullptr;
+    LockedQuote* locked = nullptr;
+    CRITICAL_SECTION cs;
+    volatile LONG stop = 0;
+    volatile LONG64 writes = 0;
+    volatile LONG64 reads = 0;
+    volatile LONG64 retries = 0;
+    volatile LONG64 torn = 0;
+};
+
+// Every write satisfies ask == bid + 5, high == low == bid and lastQuoteTime == bid,
+// so a reader can detect a torn (mixed) copy.
+static unsigned __stdcall QuoteWriter(void* arg) {
+    QuoteBench* b = (QuoteBench*)arg;
+    long long k = 0;
+    while (!b->stop) {
+        k++;
+        int i = (int)(k % QB_SYMBOLS);
+        Price bid = k;
+        if (b->useLock) {
+            CsLock lock(b->cs);
+            b->locked[i].bid = bid;
+            b->locked[i].ask = bid + 5;
+            b->locked[i].high = bid;
+            b->locked[i].low = bid;
+            b->locked[i].lastQuoteTime = k;
+        } else {
+            b->slots[i].Store(bid, bid + 5, bid, bid, k);
+        }
+    }
+    InterlockedExchangeAdd64(&b->writes, k);
+    return 0;
+}
+
+static unsigned __stdcall QuoteReader(void* arg) {
+    QuoteBench* b = (QuoteBench*)arg;
+    unsigned rng = (unsigned)(uintptr_t)&rng;  // per-thread seed
+    long long n = 0, retries = 0, torn = 0;
+    while (!b->stop) {
+        rng = rng * 1664525u + 1013904223u;
+        int i = (int)((rng >> 16) % QB_SYMBOLS);
+        Quote q;
+        if (b->useLock) {
+            CsLock lock(b->cs);
+            q.bid = b->locked[i].bid;
+            q.ask = b->locked[i].ask;
+            q.high = b->locked[i].high;
+            q.low = b->locked[i].low;
+            q.lastQuoteTime = b->locked[i].lastQuoteTime;
+        } else {
+            retries += b->slots[i].Load(q);
+        }
+        if (q.lastQuoteTime != 0 && (q.ask != q.bid + 5 || q.high != q.bid || q.low != q.bid ||
+                                   q.lastQuoteTime != (long long)q.bid))
+            torn++;
+        n++;
+    }
+    InterlockedExchangeAdd64(&b->reads, n);
+    InterlockedExchangeAdd64(&b->retries, retries);
+    InterlockedExchangeAdd64(&b->torn, torn);
+    return 0;
+}
+
+// Returns reads/sec
+static double RunQuotePass(bool useLock, const char* label) {
+    QuoteBench b;
+    b.useLock = useLock;
+    b.slots = new QuoteSlot[QB_SYMBOLS];
+    b.locked = new LockedQuote[QB_SYMBOLS]();
+    InitializeCriticalSection(&b.cs);
+
+    HANDLE threads[1 + QB_READERS];
+    long long t0 = Stats::Ticks();
+    threads[0] = (HANDLE)_beginthreadex(NULL, 0, QuoteWriter, &b, 0, NULL);
+    for (int r = 0; r < QB_READERS; r++)
+        threads[1 + r] = (HANDLE)_beginthreadex(NULL, 0, QuoteReader, &b, 0, NULL);
+
+    Sleep(QB_DURATION_MS);
+    InterlockedExchange(&b.stop, 1);
+    for (int t = 0; t < 1 + QB_READERS; t++) {
+        if (!threads[t]) continue;
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+    }
+    double sec = Stats::TicksToUs(Stats::Ticks() - t0) / 1000000.0;
+    if (sec <= 0.0) sec = 1.0;
+
+    double readsPerSec = (double)b.reads / sec;
+    double nsPerRead = (b.reads > 0) ? sec * 1e9 * QB_READERS / (double)b.reads : 0.0;
+    Log::Info("BENCH", "QUOTES %-8s writes=%.2fM/s reads=%.2fM/s (%.0f ns/read, %d readers) retries=%.4f/read torn=%lld",
+              label, (double)b.writes / sec / 1e6, readsPerSec / 1e6, nsPerRead, QB_READERS,
+              b.reads > 0 ? (double)b.retries / (double)b.reads : 0.0, (long long)b.torn);
+
+    DeleteCriticalSection(&b.cs);
+    delete[] b.slots;
+    delete[] b.locked;
+    return readsPerSec;
+}
+
+static double BenchQuotes() {
+    double locked = RunQuotePass(true, "csLock");
+    double seqlock = RunQuotePass(false, "seqlock");
+    Log::Info("BENCH", "QUOTES seqlock/csLock read throughput: %.1fx",
+              locked > 0.0 ? seqlock / locked : 0.0);
+    return seqlock;
+}
+
+// ============================================================
+// BENCH_BOOK: order book maintenance
+// A scratch book around 1.10000 with 50 quotes per side receives
+// DepthEvent-sized batches (4 quote changes: size updates, deletes,
+// new quotes at nearby prices) and publishes a snapshot after each
+// batch, exactly like HandleDepthEvent minus JSON parsing.
+// ============================================================
+
+static constexpr int BB_QUOTES_PER_SIDE = 50;
+static constexpr int BB_CHANGES_PER_EVENT = 4;
+static constexpr int BB_DURATION_MS = 1000;
+
+static double BenchBook() {
+    Book::OrderBook* book = Book::CreateScratch();
+    const long long mid = 110000;
+
+    // Quote ids: bids 1..N, asks N+1..2N; slot k always holds id k
+    unsigned long long ids[2 * BB_QUOTES_PER_SIDE];
+    unsigned long long nextId = 1;
+    for (int k = 0; k < 2 * BB_QUOTES_PER_SIDE; k++) {
+        bool isBid = k < BB_QUOTES_PER_SIDE;
+        int level = isBid ? k : k - BB_QUOTES_PER_SIDE;
+        long long price = isBid ? mid - 1 - level / 2 : mid + 1 + level / 2;
+        ids[k] = nextId++;
+        Book::ApplyNew(book, ids[k], price, 100000 + 1000 * level, isBid);
+    }
+    Book::Publish(book, 0);
+
+    unsigned rng = 12345;
+    long long events = 0, changes = 0;
+    long long t0 = Stats::Ticks();
+    while ((events & 255) != 0 || Stats::TicksToUs(Stats::Ticks() - t0) < BB_DURATION_MS * 1000.0) {
+        for (int c = 0; c < BB_CHANGES_PER_EVENT; c++) {
+            rng = rng * 1664525u + 1013904223u;
+            int k = (int)((rng >> 8) % (2 * BB_QUOTES_PER_SIDE));
+            bool isBid = k < BB_QUOTES_PER_SIDE;
+            long long offset = 1 + (long long)((rng >> 20) % 25);
+            long long price = isBid ? mid - offset : mid + offset;
+            if (rng & 1) {
+                // Size change (same id)
+                Book::ApplyNew(book, ids[k], price, 100000 + (long long)((rng >> 4) % 500000), isBid);
+            } else {
+                // Quote pulled, new quote elsewhere
+                Book::ApplyDelete(book, ids[k]);
+                ids[k] = nextId++;
+                Book::ApplyNew(book, ids[k], price, 100000 + (long long)((rng >> 4) % 500000), isBid);
+            }
+            changes++;
+        }
+        Book::Publish(book, events);
+        events++;
+    }
+    double sec = Stats::TicksToUs(Stats::Ticks() - t0) / 1000000.0;
+    if (sec <= 0.0) sec = 1.0;
+
+    // Snapshot read cost (GET_BOOK without the wait)
+    T2 quotes[2 * Book::BOOK_LEVELS];
+    const int READS = 100000;
+    int n = 0;
+    long long r0 = Stats::Ticks();
+    for (int i = 0; i < READS; i++) n = Book::ReadSnapshot(book, quotes, 2 * Book::BOOK_LEVELS);
+    double nsPerRead = Stats::TicksToUs(Stats::Ticks() - r0) * 1000.0 / READS;
+
+    Log::Info("BENCH", "BOOK events=%.2fM/s quote changes=%.2fM/s (%.0f ns/event incl. publish) snapshot read=%.0f ns (%d quotes)",
+              (double)events / sec / 1e6, (double)changes / sec / 1e6,
+              events > 0 ? sec * 1e9 / (double)events : 0.0, nsPerRead, n);
+
+    Book::DestroyScratch(book);
+    return (double)changes / sec;
+}
+
+double Run(int id) {
+    switch (id) {
+        case BENCH_QUOTES: return BenchQuotes();
+        case BENCH_BOOK: return BenchBook();
+        default:
+            Log::Warn("BENCH", "Unknown benchmark id %d", id);
+            return 0;
+    }
+}
+
+} // namespace Bench
@@ -0,0 +1,335 @@
+#include "../include/state.h"
+#include "../include/book.h"
+#include "../include/symbols.h"
+#include "../include/protocol.h"
+#include "../include/websocket.h"
+#include "../include/logger.h"
+#include "../include/utils.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+namespace Book {
+
+// ============================================================
+// Book layout
+// Quotes live in two flat arrays sorted by price (bids descending,
+// asks ascending, FIFO within a price), plus an id-sorted reference
+// array for DepthEvent deletes. No per-level heap nodes: a DepthEvent
+// is a few binary searches and memmoves over contiguous memory.
+// ============================================================
+
+struct DepthQuote {
+    unsigned long long id;
+    long long price;      // raw (PRICE_SCALE)
+    long long size;       // volume in cents
+};
+
+struct QuoteRef {
+    unsigned long long id;
+    long long price;
+    bool isBid;
+};
+
+// Top-of-book snapshot, seqlock-published like QuoteSlot
+struct alignas(64) Snapshot {
+    std::atomic<unsigned> seq{0};
+    std::atomic<long long> timeMs{0};
+    std::atomic<int> nBids{0};
+    std::atomic<int> nAsks{0};
+    std::atomic<long long> bidPrice[BOOK_LEVELS];
+    std::atomic<long long> bidSize[BOOK_LEVELS];
+    std::atomic<long long> askPrice[BOOK_LEVELS];
+    std::atomic<long long> askSize[BOOK_LEVELS];
+};
+
+struct OrderBook {
+    long long symbolId = 0;
+    std::vector<DepthQuote> bids;
+    std::vector<DepthQuote> asks;
+    std::vector<QuoteRef> refs;   // sorted by id
+    Snapshot snap;
+};
+
+// Books by symbol handle. Created by Subscribe (Zorro thread),
+// filled by HandleDepthEvent (NetworkThread), deleted only by Reset().
+static std::atomic<OrderBook*> s_books[MAX_SYMBOLS];
+
+// ============================================================
+// Update (single writer)
+// ============================================================
+
+static std::vector<QuoteRef>::iterator FindRef(OrderBook* book, unsigned long long id) {
+    return std::lower_bound(book->refs.begin(), book->refs.end(), id,
+        [](const QuoteRef& r, unsigned long long v) { return r.id < v; });
+}
+
+// First quote at `price` or worse on this side
+static std::vector<DepthQuote>::iterator PriceBound(std::vector<DepthQuote>& side, long long price, bool isBid) {
+    if (isBid)
+        return std::lower_bound(side.begin(), side.end(), price,
+            [](const DepthQuote& q, long long p) { return q.price > p; });
+    return std::lower_bound(side.begin(), side.end(), price,
+        [](const DepthQuote& q, long long p) { return q.price < p; });
+}
+
+void ApplyDelete(OrderBook* book, unsigned long long quoteId) {
+    auto ref = FindRef(book, quoteId);
+    if (ref == book->refs.end() || ref->id != quoteId) return;
+
+    std::vector<DepthQuote>& side = ref->isBid ? book->bids : book->asks;
+    for (auto it = PriceBound(side, ref->price, ref->isBid);
+         it != side.end() && it->price == ref->price; ++it) {
+        if (it->id == quoteId) {
+            side.erase(it);
+            break;
+        }
+    }
+    book->refs.erase(ref);
+}
+
+void ApplyNew(OrderBook* book, unsigned long long quoteId, long long rawPrice, long long size, bool isBid) {
+    // A known id is a replacement (size or price change)
+    auto ref = FindRef(book, quoteId);
+    if (ref != book->refs.end() && ref->id == quoteId) {
+        ApplyDelete(book, quoteId);
+        ref = FindRef(book, quoteId);
+    }
+    if (rawPrice <= 0 || size <= 0) return;
+
+    std::vector<DepthQuote>& side = isBid ? book->bids : book->asks;
+    auto it = PriceBound(side, rawPrice, isBid);
+    while (it != side.end() && it->price == rawPrice) ++it;  // FIFO within a price
+    side.insert(it, DepthQuote{ quoteId, rawPrice, size });
+    book->refs.insert(ref, QuoteRef{ quoteId, rawPrice, isBid });
+}
+
+// Sum quotes per price, best first, up to BOOK_LEVELS levels
+static int Aggregate(const std::vector<DepthQuote>& side, long long* prices, long long* sizes) {
+    int n = 0;
+    for (const DepthQuote& q : side) {
+        if (n > 0 && prices[n - 1] == q.price) {
+            sizes[n - 1] += q.size;
+            continue;
+        }
+        if (n == BOOK_LEVELS) break;
+        prices[n] = q.price;
+        sizes[n] = q.size;
+        n++;
+    }
+    return n;
+}
+
+void Publish(OrderBook* book, long long timeMs) {
+    long long bp[BOOK_LEVELS], bs[BOOK_LEVELS], ap[BOOK_LEVELS], as[BOOK_LEVELS];
+    int nb = Aggregate(book->bids, bp, bs);
+    int na = Aggregate(book->asks, ap, as);
+
+    Snapshot& s = book->snap;
+    unsigned seq = s.seq.load(std::memory_order_relaxed);
+    s.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.timeMs.store(timeMs, std::memory_order_relaxed);
+    s.nBids.store(nb, std::memory_order_relaxed);
+    s.nAsks.store(na, std::memory_order_relaxed);
+    for (int i = 0; i < nb; i++) {
+        s.bidPrice[i].store(bp[i], std::memory_order_relaxed);
+        s.bidSize[i].store(bs[i], std::memory_order_relaxed);
+    }
+    for (int i = 0; i < na; i++) {
+        s.askPrice[i].store(ap[i], std::memory_order_relaxed);
+        s.askSize[i].store(as[i], std::memory_order_relaxed);
+    }
+    s.seq.store(seq + 2, std::memory_order_release);
+}
+
+// ============================================================
+// Read (any thread, lock-free)
+// ============================================================
+
+int ReadSnapshot(const OrderBook* book, T2* out, int maxQuotes) {
+    if (!book || !out || maxQuotes <= 0) return 0;
+
+    const Snapshot& s = book->snap;
+    long long bp[BOOK_LEVELS], bs[BOOK_LEVELS], ap[BOOK_LEVELS], as[BOOK_LEVELS];
+    long long timeMs;
+    int nb, na;
+    for (;;) {
+        unsigned s0 = s.seq.load(std::memory_order_acquire);
+        if (s0 & 1) { YieldProcessor(); continue; }
+        timeMs = s.timeMs.load(std::memory_order_relaxed);
+        nb = s.nBids.load(std::memory_order_relaxed);
+        na = s.nAsks.load(std::memory_order_relaxed);
+        if (nb > BOOK_LEVELS) nb = BOOK_LEVELS;
+        if (na > BOOK_LEVELS) na = BOOK_LEVELS;
+        for (int i = 0; i < nb; i++) {
+            bp[i] = s.bidPrice[i].load(std::memory_order_relaxed);
+            bs[i] = s.bidSize[i].load(std::memory_order_relaxed);
+        }
+        for (int i = 0; i < na; i++) {
+            ap[i] = s.askPrice[i].load(std::memory_order_relaxed);
+            as[i] = s.askSize[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) == s0) break;
+    }
+
+    DATE t = Utils::UnixToOle(timeMs);
+    int n = 0;
+    for (int i = 0; i < nb && n < maxQuotes; i++, n++) {
+        out[n].time = t;
+        out[n].fPrice = -(float)PriceToDouble(bp[i]);
+        out[n].fVol = (float)((double)bs[i] / 100.0);  // cents -> units
+    }
+    for (int i = 0; i < na && n < maxQuotes; i++, n++) {
+        out[n].time = t;
+        out[n].fPrice = (float)PriceToDouble(ap[i]);
+        out[n].fVol = (float)((double)as[i] / 100.0);
+    }
+    return n;
+}
+
+// ============================================================
+// Subscription
+// ============================================================
+
+static bool SendDepthSubscribe(const char* idList) {
+    char payload[4200];
+    sprintf_s(payload, "\"ctidTraderAccountId\":%lld,\"symbolId\":[%s]", G.accountId, idList);
+    const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
+                                             PayloadType::SubscribeDepthQuotesReq, payload);
+    return WebSocket::Send(msg, ToInt(PayloadType::SubscribeDepthQuotesReq));
+}
+
+bool Subscribe(const char* symbolName) {
+    if (!symbolName || !*symbolName) return false;
+
+    int handle = Symbols::GetHandle(symbolName);
+    if (handle < 0) {
+        Log::Warn("BOOK", "Symbol not found: %s", symbolName);
+        return false;
+    }
+    if (s_books[handle].load(std::memory_order_acquire)) return true;
+
+    SymbolInfo sym;
+    if (!Symbols::GetSymbol(symbolName, sym)) return false;
+
+    {
+        CsLock lock(G.csSymbols);  // serializes book creation between Zorro threads
+        if (s_books[handle].load(std::memory_order_relaxed)) return true;
+        OrderBook* book = new OrderBook();
+        book->symbolId = sym.symbolId;
+        book->bids.reserve(64);
+        book->asks.reserve(64);
+        book->refs.reserve(128);
+        s_books[handle].store(book, std::memory_order_release);
+    }
+
+    char idList[32];
+    sprintf_s(idList, "%lld", sym.symbolId);
+    if (!SendDepthSubscribe(idList)) return false;
+
+    Log::Diag(1, "BOOK Depth subscribe sent for %s (id=%lld)", symbolName, sym.symbolId);
+    return true;
+}
+
+void BatchResubscribe() {
+    char idList[4096] = {0};
+    int pos = 0, count = 0;
+
+    for (int h = 0; h < MAX_SYMBOLS; h++) {
+        OrderBook* book = s_books[h].load(std::memory_order_acquire);
+        if (!book) continue;
+
+        // Server resends the full book as newQuotes after subscribing
+        book->bids.clear();
+        book->asks.clear();
+        book->refs.clear();
+        Publish(book, Utils::NowUnixMs());
+
+        if (pos > (int)sizeof(idList) - 32) break;
+        pos += sprintf_s(idList + pos, sizeof(idList) - pos, count ? ",%lld" : "%lld", book->symbolId);
+        count++;
+    }
+
+    if (count > 0) {
+        SendDepthSubscribe(idList);
+        Log::Info("BOOK", "Resubscribed depth for %d symbols", count);
+    }
+}
+
+void HandleDepthEvent(const char* buffer) {
+    long long symbolId = Protocol::ExtractInt64(buffer, "symbolId");
+    int handle = Symbols::GetHandleById(symbolId);
+    if (handle < 0) return;
+
+    OrderBook* book = s_books[handle].load(std::memory_order_acquire);
+    if (!book) return;
+
+    // Deletes first: ExtractArray reuses one buffer, so finish each array before the next
+    const char* arr = Protocol::ExtractArray(buffer, "deletedQuotes");
+    int count = Protocol::CountArrayElements(arr);
+    for (int i = 0; i < count; i++) {
+        const char* elem = Protocol::GetArrayElement(arr, i);
+        if (*elem == '"') elem++;
+        ApplyDelete(book, (unsigned long long)_atoi64(elem));
+    }
+
+    arr = Protocol::ExtractArray(buffer, "newQuotes");
+    count = Protocol::CountArrayElements(arr);
+    for (int i = 0; i < count; i++) {
+        const char* elem = Protocol::GetArrayElement(arr, i);
+        if (!elem || !*elem) continue;
+
+        unsigned long long id = (unsigned long long)Protocol::ExtractInt64(elem, "id");
+        long long size = Protocol::ExtractInt64(elem, "size");
+        bool isBid = Protocol::HasField(elem, "bid");
+        long long price = Protocol::ExtractInt64(elem, isBid ? "bid" : "ask");
+        ApplyNew(book, id, price, size, isBid);
+    }
+
+    Publish(book, Utils::NowUnixMs());
+}
+
+int GetBook(const char* symbolName, T2* out, int maxQuotes) {
+    if (!Subscribe(symbolName)) return 0;
+
+    OrderBook* book = s_books[Symbols::GetHandle(symbolName)].load(std::memory_order_acquire);
+    if (!book) return 0;
+
+    // First request: wait for the initial DepthEvent
+    if (book->snap.seq.load(std::memory_order_acquire) == 0) {
+        ULONGLONG waitStart = GetTickCount64();
+        while (GetTickCount64() - waitStart < 1000) {
+            Sleep(50);
+            if (book->snap.seq.load(std::memory_order_acquire) != 0) break;
+        }
+    }
+    return ReadSnapshot(book, out, maxQuotes);
+}
+
+void Reset() {
+    for (int h = 0; h < MAX_SYMBOLS; h++) {
+        OrderBook* book = s_books[h].exchange(nullptr);
+        delete book;
+    }
+}
+
+// ============================================================
+// Scratch books (Bench)
+// ============================================================
+
+OrderBook* CreateScratch() {
+    OrderBook* book = new OrderBook();
+    book->bids.reserve(64);
+    book->asks.reserve(64);
+    book->refs.reserve(128);
+    return book;
+}
+
+void DestroyScratch(OrderBook* book) {
+    delete book;
+}
+
+} // namespace Book
@@ -7,14 +7,39 @@
 #include "../include/trading.h"
 #include "../include/logger.h"
 #include "../include/utils.h"
+#include "../include/stats.h"
+#include "../include/bench.h"
+#include "../include/book.h"
+#include "../include/journal.h"
+#include "../include/bars.h"
+#include "../include/feed.h"
+#include "../include/rates.h"
+#include "../include/symcache.h"
+#include "../include/health.h"
+#include "../include/subs.h"
+#include "../include/tickring.h"
+#include "../include/spread.h"
+#include "../include/indicators.h"
+#include "../include/symtable.h"
+#include "../include/histstore.h"
 #include "../include/zorro_constants.h"
 #include <cstdio>
 #include <cstring>
 #include <cmath>
 #include <vector>
+#include <algorithm>
 #include <process.h>
 #include <oleauto.h>  // VariantTimeToSystemTime
 
+// 10^n from a table for the digit counts of prices and money (pow() otherwise)
+static double Pow10(int n) {
+    static const double table[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16 };
+    if (n >= 0 && n <= 16) return table[n];
+    if (n < 0 && n >= -16) return 1.0 / table[-n];
+    return pow(10.0, (double)n);
+}
+
 // ============================================================
 // M7: LotAmount helper - clamps to minimum 1.0 for CFD indices
 // lotSize is in cents (100 cents = 1 base unit)
@@ -46,18 +71,18 @@ static double ComputeLotAmount(long long minVolume, long long lotSize) {
 // Zorro expects: $/day per 10K units (forex) or per contract (others)
 // cTrader swapCalculationType: 0=PIPS, 1=PERCENTAGE(annual), 2=POINTS
 // ============================================================
-static double ConvertSwapToZorro(double swapValue, const SymbolInfo& sym) {
+static double ConvertSwapToZorro(double swapValue, const SymbolInfo& sym,
+                                 double bid, double ask, double qRate) {
     if (swapValue == 0.0) return 0.0;
 
     double lotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
     // Forex heuristic: LotAmount >= 100 (lotSize >= 1M cents = 10K+ base units)
     bool isForex = (lotAmount >= 100.0);
-    // M9: Use accurate conversion rate (handles cross-currency pairs like USDJPY on USD account)
-    double qRate = Symbols::GetQuoteToDepositRate(sym);
+    // qRate: quote->deposit rate (M9, handles cross-currency pairs like USDJPY on USD account)
 
     switch (sym.swapCalculationType) {
     case 0: { // PIPS
-        double pip = pow(10.0, -(double)sym.pipPosition);
+        double pip = Pow10(-sym.pipPosition);
         if (isForex) {
             return swapValue * pip * 10000.0 * qRate;
         } else {
@@ -65,8 +90,8 @@ static double ConvertSwapToZorro(double swapValue, const SymbolInfo& sym) {
         }
     }
     case 1: { // PERCENTAGE (annual)
-        double price = (sym.bid + sym.ask) / 2.0;
-        if (price <= 0.0) price = sym.ask > 0.0 ? sym.ask : sym.bid;
+        double price = (bid + ask) / 2.0;
+        if (price <= 0.0) price = ask > 0.0 ? ask : bid;
         if (price <= 0.0) return 0.0;
         double dailyFraction = swapValue / 100.0 / 365.0;
         if (isForex) {
@@ -76,7 +101,7 @@ static double ConvertSwapToZorro(double swapValue, const SymbolInfo& sym) {
         }
     }
     case 2: { // POINTS (uses digits instead of pipPosition)
-        double point = pow(10.0, -(double)sym.digits);
+        double point = Pow10(-sym.digits);
         if (isForex) {
             return swapValue * point * 10000.0 * qRate;
         } else {
@@ -95,10 +120,10 @@ static double ConvertSwapToZorro(double swapValue, const SymbolInfo& sym) {
 // cTrader commissionType: 1=USD_PER_MIL_USD, 2=USD_PER_LOT, 3=PERCENTAGE, 4=QUOTE_CCY_PER_LOT
 // cTrader commission is per SIDE (one-way), Zorro wants round-turn (both sides)
 // ============================================================
-static double ConvertCommissionToZorro(const SymbolInfo& sym) {
+static double ConvertCommissionToZorro(const SymbolInfo& sym, double bid, double ask, double qRate) {
     if (sym.commissionRaw == 0) return 0.0;
 
-    double moneyScale = pow(10.0, (double)G.moneyDigits);
+    double moneyScale = Pow10(G.moneyDigits);
     double commPerSide = (double)sym.commissionRaw / moneyScale;  // actual $ per side
     double unitsPerLot = (double)sym.lotSize / 100.0;  // 10M cents → 100K units
     if (unitsPerLot <= 0.0) unitsPerLot = 100000.0;
@@ -115,7 +140,7 @@ static double ConvertCommissionToZorro(const SymbolInfo& sym) {
     case 1: { // USD_PER_MIL_USD
         // commPerSide = $ per $1M USD volume per side
         // Need notional in USD per 10K units of the asset
-        double price = sym.ask > 0.0 ? sym.ask : sym.bid;
+        double price = ask > 0.0 ? ask : bid;
         if (price <= 0.0) return 0.0;
         double notionalUsdPer10K;
         if (G.depositAssetId > 0 && sym.baseAssetId == G.depositAssetId) {
@@ -132,7 +157,7 @@ static double ConvertCommissionToZorro(const SymbolInfo& sym) {
         // commPerSide = percentage of trade value per side
         // Per 10K units: notional = price * 10000
         // Round-trip per 10K = 2 * (commPerSide/100) * price * 10000
-        double price = sym.ask > 0.0 ? sym.ask : sym.bid;
+        double price = ask > 0.0 ? ask : bid;
         if (price <= 0.0) return 0.0;
         roundTripPer10K = 2.0 * (commPerSide / 100.0) * price * 10000.0;
         break;
@@ -140,7 +165,6 @@ static double ConvertCommissionToZorro(const SymbolInfo& sym) {
     case 4: { // QUOTE_CCY_PER_LOT
         // Commission in quote currency per lot per side
         // M9: Convert to account currency using conversion chain
-        double qRate = Symbols::GetQuoteToDepositRate(sym);
         roundTripPer10K = 2.0 * commPerSide * qRate * 10000.0 / unitsPerLot;
         break;
     }
@@ -152,6 +176,35 @@ static double ConvertCommissionToZorro(const SymbolInfo& sym) {
     return -roundTripPer10K;
 }
 
+// M7: per-symbol margin from ExpectedMarginRes (positive = direct margin cost per lot)
+// Zorro support confirmed: return real margin cost, NOT negative leverage
+// Minimum threshold: 1 cent (0.01) per Zorro support
+static double MarginCostPerLot(const SymbolInfo& sym, double price) {
+    if (sym.marginPerLot > 0.01) return sym.marginPerLot;  // positive = direct margin per lot
+    if (G.leverageInCents <= 0) return 0.0;
+
+    // Fallback: calculate from global leverage using dynamic LotAmount
+    double lotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
+    if (price <= 0.0 || lotAmount <= 0.0) return 0.0;
+    return lotAmount * price / ((double)G.leverageInCents / 100.0);
+}
+
+// BrokerAsset values of one symbol from its fixed-point quote and quote->deposit rate
+static void FillAssetQuote(AssetQuote& a, const SymbolInfo& sym, Price rawBid, Price rawAsk,
+                           long long quoteTime, double qRate) {
+    double lotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
+    double bid = PriceToDouble(rawBid), ask = PriceToDouble(rawAsk);
+    a.price = PriceToDouble(rawAsk > 0 ? rawAsk : rawBid);
+    a.spread = (rawAsk > 0 && rawBid > 0) ? PriceToDouble(rawAsk - rawBid) : 0.0;
+    a.pipCost = Pow10(-sym.pipPosition) * lotAmount * qRate;  // PIP * LotAmount * quote->deposit
+    a.marginCost = MarginCostPerLot(sym, a.price);
+    a.rollLong = ConvertSwapToZorro(sym.swapLong, sym, bid, ask, qRate);
+    a.rollShort = ConvertSwapToZorro(sym.swapShort, sym, bid, ask, qRate);
+    a.commission = ConvertCommissionToZorro(sym, bid, ask, qRate);
+    a.quoteTime = quoteTime > 0 ? Utils::UnixToOle(quoteTime) : 0.0;
+    a.valid = 1;
+}
+
 // ============================================================
 // Network Thread - receives messages and dispatches
 // ============================================================
@@ -215,7 +268,9 @@ static unsigned __stdcall NetworkThread(void* param) {
 
                     if (ok) {
                         // Resubscribe and reconcile
-                        Symbols::BatchResubscribe();
+                        Subs::Resubscribe();
+                        Book::BatchResubscribe();
+                        Bars::BatchResubscribe();
                         Trading::RequestReconcile();
                         G.reconnectAttempts = 0;
                         G.lastHeartbeatMs = GetTickCount64();
@@ -241,7 +296,7 @@ static unsigned __stdcall NetworkThread(void* param) {
         if (now - G.lastHeartbeatMs > PING_INTERVAL_MS) {
             const char* hb = Protocol::BuildMessage(Utils::NextMsgId(),
                                                     PayloadType::HeartbeatEvent, "");
-            bool sent = WebSocket::Send(hb);
+            bool sent = WebSocket::Send(hb, ToInt(PayloadType::HeartbeatEvent));
             if (!sent) {
                 Log::Warn("NET", "Heartbeat send FAILED! wsConnected=%d hWebSocket=%p",
                           (int)G.wsConnected, (void*)G.hWebSocket);
@@ -249,19 +304,38 @@ static unsigned __stdcall NetworkThread(void* param) {
             G.lastHeartbeatMs = now;
         }
 
-        // Periodic alive log (every 60s)
+        // Periodic alive log (every 60s): roll traffic window and log it
         if (now - lastAliveLog > 60000) {
             lastAliveLog = now;
+            Stats::Roll();
+            Stats::LogSnapshot();
+            Feed::LogSnapshot();
+            Health::Roll();
+            Health::LogSnapshot();
+            Subs::Sweep();
+            Spread::Roll();
         }
 
+        // Bars of quiet symbols close on time
+        Indicators::Tick();
+
         // Try to receive
         int n = WebSocket::Receive(buffer, NET_BUF_SIZE);
         if (n <= 0) {
             Sleep(10);
             continue;
         }
+        long long recvTicks = Stats::Ticks();
 
         int pt = Protocol::ExtractPayloadType(buffer);
+        Stats::RecordReceive(pt, n);
+
+        // Receive-to-dispatch time including the handler, recorded on every exit path
+        // of this iteration
+        struct DispatchTimer {
+            int pt; long long t0;
+            ~DispatchTimer() { if (t0) Stats::RecordDispatch(pt, t0); }
+        } dispatchTimer = { pt, recvTicks };
 
         // If waiting for history response, forward GetTrendbarsRes/ErrorRes
         if (G.waitingForHistory &&
@@ -323,7 +397,7 @@ static unsigned __stdcall NetworkThread(void* param) {
 
         switch (pt) {
             case ToInt(PayloadType::SpotEvent):
-                Symbols::HandleSpotEvent(buffer);
+                Symbols::HandleSpotEvent(buffer, recvTicks);
                 break;
 
             case ToInt(PayloadType::MarginChangedEvent):
@@ -338,6 +412,22 @@ static unsigned __stdcall NetworkThread(void* param) {
                 Log::Diag(1, "SubscribeSpotsRes received");
                 break;
 
+            case ToInt(PayloadType::UnsubscribeSpotsRes):
+                Log::Diag(1, "UnsubscribeSpotsRes received");
+                break;
+
+            case ToInt(PayloadType::DepthEvent):
+                Book::HandleDepthEvent(buffer);
+                break;
+
+            case ToInt(PayloadType::SubscribeDepthQuotesRes):
+                Log::Diag(1, "SubscribeDepthQuotesRes received");
+                break;
+
+            case ToInt(PayloadType::SubscribeLiveTrendbarRes):
+                Log::Diag(1, "SubscribeLiveTrendbarRes received");
+                break;
+
             case ToInt(PayloadType::HeartbeatEvent):
                 Log::Diag(2, "Heartbeat received");
                 break;
@@ -357,8 +447,26 @@ static unsigned __stdcall NetworkThread(void* param) {
                 break;
 
             case ToInt(PayloadType::ExpectedMarginRes):
-                Symbols::HandleExpectedMarginRes(buffer);
-                if (G.waitingForMargin) G.marginResponseReady = true;
+                if (Symbols::HandleExpectedMarginRes(buffer) && G.waitingForMargin)
+                    G.marginResponseReady = true;
+                break;
+
+            case ToInt(PayloadType::SymbolsListRes):
+                // New symbols outside a revalidation (SymbolChangedEvent): extend the asset graph
+                if (Symbols::HandleSymbolsListRes(buffer, SymCache::IsRevalidating()) > 0 &&
+                    !SymCache::IsRevalidating()) Rates::Build();
+                SymCache::OnSymbolList();
+                Symbols::FlushDetailQueue();  // contracts of new symbols (eager details)
+                break;
+
+            case ToInt(PayloadType::SymbolByIdRes):
+                Symbols::HandleSymbolByIdRes(buffer);
+                SymCache::OnSymbolDetails(buffer);
+                Symbols::FlushDetailQueue();  // changes queued behind an outstanding request
+                break;
+
+            case ToInt(PayloadType::SymbolChangedEvent):
+                Symbols::HandleSymbolChangedEvent(buffer);
                 break;
 
             case ToInt(PayloadType::SymbolsForConversionRes):
@@ -368,6 +476,8 @@ static unsigned __stdcall NetworkThread(void* param) {
             case ToInt(PayloadType::ErrorRes):
                 Log::Error("NET", "Error from server: %s",
                           Protocol::ExtractString(buffer, "description"));
+                Symbols::HandleRequestError(buffer);
+                SymCache::OnRequestError(buffer);
                 break;
 
             case ToInt(PayloadType::AccountsTokenInvalidatedEvent):
@@ -387,6 +497,7 @@ static unsigned __stdcall NetworkThread(void* param) {
     }
 
     free(buffer);
+    SymTable::ReleaseThread();
     Log::Info("NET", "NetworkThread exiting (G.running=%d)", (int)G.running);
     return 0;
 }
@@ -423,6 +534,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD reason, LPVOID reserved) {
     }
     else if (reason == DLL_PROCESS_DETACH) {
         StopNetworkThread();
+        Journal::Stop();
         WebSocket::Disconnect();
         StateInit::Destroy();
     }
@@ -442,6 +554,7 @@ DLLFUNC int BrokerOpen(char* Name, int(__cdecl* fpMessage)(const char*),
     if (!Name) {
         Log::Info("BROKER", "BrokerOpen(NULL): graceful shutdown");
         StopNetworkThread();
+        Journal::Stop();
         WebSocket::Disconnect();
         G.loggedIn = false;
         G.loginCompleted = false;
@@ -503,6 +616,9 @@ DLLFUNC int BrokerLogin(char* User, char* Pwd, char* Type, char* Accounts) {
         // Logout
         Log::Info("BROKER", "BrokerLogin: logout requested");
         StopNetworkThread();
+        if (G.loginCompleted) SymCache::Save();
+        Spread::Flush(true);
+        HistStore::Release();
         WebSocket::Disconnect();
         G.loggedIn = false;
         G.loginCompleted = false;
@@ -581,34 +697,38 @@ DLLFUNC int BrokerLogin(char* User, char* Pwd, char* Type, char* Accounts) {
         G.reconnectAttempts = 0;
         G.isReconnecting = false;
 
-        // Try to reload symbol list, but continue with cached symbols if it fails
-        bool symOk = Symbols::RequestSymbolList();
-        if (symOk) {
-            Symbols::RequestSymbolDetails();
-        } else {
+        // Symbols still in memory: keep them and revalidate in the background.
+        // Otherwise reload synchronously.
+        bool haveSymbols;
+        {
             CsLock lock(G.csSymbols);
-            int existingSyms = (int)G.symbols.size();
-            if (existingSyms > 0) {
-                Log::Warn("BROKER", "Reconnect: symbol list failed but have %d cached symbols, continuing", existingSyms);
-            } else {
+            haveSymbols = !G.symbols.empty();
+        }
+        if (!haveSymbols) {
+            if (!Symbols::RequestSymbolList()) {
                 Log::Error("BROKER", "Reconnect: no symbols available");
                 WebSocket::Disconnect();
                 G.loggedIn = false;
                 return 0;
             }
-        }
+            if (!G.lazyDetails) Symbols::RequestSymbolDetails();
 
-        // Refresh account info
-        Account::RequestTraderInfo();
+            // Refresh account info, then the conversion graph (needs depositAssetId)
+            Account::RequestTraderInfo();
+            Rates::Build();
+        }
 
         // Re-reconcile positions to sync with server
         Trading::RequestReconcile();
 
-        // Resubscribe to spot events for previously subscribed symbols
-        Symbols::BatchResubscribe();
+        // Resubscribe to spot events and depth for previously subscribed symbols
+        Subs::Resubscribe();
+        Book::BatchResubscribe();
+        Bars::BatchResubscribe();
 
         // Restart network thread
         StartNetworkThread();
+        if (haveSymbols) SymCache::Revalidate();
 
         Log::Info("BROKER", "Reconnect complete. %d symbols, %d trades.",
                   (int)G.symbols.size(), (int)G.trades.size());
@@ -630,24 +750,35 @@ DLLFUNC int BrokerLogin(char* User, char* Pwd, char* Type, char* Accounts) {
         return 0;
     }
 
-    // Request symbol list
-    if (!Symbols::RequestSymbolList()) {
-        Log::Error("BROKER", "Failed to load symbol list");
-        WebSocket::Disconnect();
-        return 0;
-    }
+    // Warm login: symbol table from the account snapshot, revalidated once the
+    // NetworkThread runs. Cold login: symbol list, details and account info now.
+    bool warm = SymCache::Load();
+    if (!warm) {
+        // Request symbol list
+        if (!Symbols::RequestSymbolList()) {
+            Log::Error("BROKER", "Failed to load symbol list");
+            WebSocket::Disconnect();
+            return 0;
+        }
 
-    // Request symbol details (batched)
-    Symbols::RequestSymbolDetails();
+        // Request symbol details (batched), or on first use per symbol
+        if (!G.lazyDetails) Symbols::RequestSymbolDetails();
+        else Log::Info("BROKER", "Lazy symbol details: loaded on first use");
 
-    // Request account info
-    Account::RequestTraderInfo();
+        // Request account info
+        Account::RequestTraderInfo();
+    }
+
+    // Conversion graph (needs depositAssetId)
+    Rates::Build();
 
     // Reconcile open positions before starting network thread
     Trading::RequestReconcile();
 
     // Start network thread for async events
     StartNetworkThread();
+    if (warm) SymCache::Revalidate();
+    else SymCache::Save();
 
     G.loginCompleted = true;
     Log::Info("BROKER", "Login complete. %d symbols loaded.", (int)G.symbols.size());
@@ -697,6 +828,13 @@ DLLFUNC int BrokerTime(DATE* pTimeGMT) {
         return 1;  // connected but no live data (market closed)
     }
 
+    // Recorded spread minutes to disk, at most once a minute
+    static ULONGLONG lastSpreadFlush = 0;
+    if (now - lastSpreadFlush > 60000) {
+        lastSpreadFlush = now;
+        Spread::Flush();
+    }
+
     return 2;
 }
 
@@ -706,27 +844,40 @@ DLLFUNC int BrokerAsset(char* Asset, double* pPrice, double* pSpread,
                         double* pRollLong, double* pRollShort) {
     if (!Asset || !G.loggedIn) return 0;
 
-    // Subscribe if not already
-    Symbols::Subscribe(Asset);
+    // Subscribe if not already (renews the idle lease); contract details on first use
+    unsigned seq0 = Symbols::QuoteSeq(Symbols::GetHandle(Asset));
+    bool subscribedNow = Subs::Use(Asset);
+    if (G.lazyDetails) Symbols::EnsureDetails(Asset);
 
     SymbolInfo sym;
     if (!Symbols::GetSymbol(Asset, sym)) return 0;
 
-    // Wait up to 2s for both bid and ask to arrive (SpotEvents are async)
-    if (sym.bid <= 0.0 || sym.ask <= 0.0) {
+    // Wait up to 2s for both bid and ask to arrive (SpotEvents are async).
+    // After an idle unsubscribe the table still holds the old quote: wait for a new one.
+    if (sym.bid <= 0 || sym.ask <= 0 || subscribedNow) {
         ULONGLONG waitStart = GetTickCount64();
+        Quote q;
         while (GetTickCount64() - waitStart < 2000) {
             Sleep(50);
-            if (!Symbols::GetSymbol(Asset, sym)) return 0;
-            if (sym.bid > 0.0 && sym.ask > 0.0) break;
+            if (!Symbols::GetQuote(sym.handle, q)) break;
+            sym.bid = q.bid;
+            sym.ask = q.ask;
+            sym.lastQuoteTime = q.lastQuoteTime;
+            bool fresh = !subscribedNow || Symbols::QuoteSeq(sym.handle) != seq0;
+            if (sym.bid > 0 && sym.ask > 0 && fresh) break;
         }
     }
 
-    if (sym.bid <= 0.0 && sym.ask <= 0.0) return 0;
+    if (sym.bid <= 0 && sym.ask <= 0) return 0;
 
     // M7: Lazy-load per-symbol margin via ExpectedMarginReq
     if (sym.marginPerLot <= 0.0 && sym.symbolId > 0 && WebSocket::IsConnected()) {
-        G.marginPendingSymbolId = sym.symbolId;
+        std::string marginMsgId = Utils::NextMsgId();
+        {
+            CsLock lock(G.csSymbols);
+            G.marginPendingSymbolId = sym.symbolId;
+            G.marginPendingMsgId = marginMsgId;
+        }
         G.waitingForMargin = true;
         G.marginResponseReady = false;
 
@@ -739,9 +890,9 @@ DLLFUNC int BrokerAsset(char* Asset, double* pPrice, double* pSpread,
         sprintf_s(marginPayload, "\"ctidTraderAccountId\":%lld,\"symbolId\":%lld,\"volume\":[%lld]",
                   G.accountId, sym.symbolId, marginVolume);
 
-        const char* marginMsg = Protocol::BuildMessage(Utils::NextMsgId(),
+        const char* marginMsg = Protocol::BuildMessage(marginMsgId.c_str(),
                                                         PayloadType::ExpectedMarginReq, marginPayload);
-        if (WebSocket::Send(marginMsg)) {
+        if (WebSocket::Send(marginMsg, ToInt(PayloadType::ExpectedMarginReq))) {
             // Spin-wait max 3s for response
             ULONGLONG marginStart = GetTickCount64();
             while (GetTickCount64() - marginStart < 3000) {
@@ -761,63 +912,35 @@ DLLFUNC int BrokerAsset(char* Asset, double* pPrice, double* pSpread,
         G.waitingForMargin = false;
     }
 
-    if (pPrice) *pPrice = sym.ask > 0.0 ? sym.ask : sym.bid;
-    if (pSpread) *pSpread = (sym.ask > 0.0 && sym.bid > 0.0) ? (sym.ask - sym.bid) : 0.0;
+    // Quote->deposit rate once for pip cost, rollover and commission (M9)
+    bool needRate = pPipCost || pVolume || pRollLong || pRollShort;
+    double qRate = needRate ? Symbols::GetQuoteToDepositRate(sym) : 1.0;
+    AssetQuote a = {};
+    FillAssetQuote(a, sym, sym.bid, sym.ask, sym.lastQuoteTime, qRate);
 
-    if (pPip) {
-        // pipPosition: e.g. 4 means pip = 0.0001
-        *pPip = 1.0 / pow(10.0, (double)sym.pipPosition);
-    }
-
-    if (pVolume) {
-        // M8b: Commission from broker payload → Zorro pVolume
-        // Negative = deducted from account (not included in spread)
-        *pVolume = ConvertCommissionToZorro(sym);
-    }
+    if (pPrice) *pPrice = a.price;
+    if (pSpread) *pSpread = a.spread;
+    if (pPip) *pPip = Pow10(-sym.pipPosition);  // pipPosition 4 -> pip = 0.0001
 
-    if (pLotAmount) {
-        // M7: ComputeLotAmount clamps to min 1.0 for CFD indices
-        // Forex(10M)=1000, Gold(10K)=1, Index(100)=1 (clamped)
-        *pLotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
-    }
+    // M8b: Commission from broker payload; negative = deducted from account (not in spread)
+    if (pVolume) *pVolume = a.commission;
 
-    if (pPipCost) {
-        // PIPCost = PIP * LotAmount * QuoteCurrencyToAccountRate
-        // M9: Uses SymbolsForConversionReq (2118) for cross-currency pairs
-        double pip = 1.0 / pow(10.0, (double)sym.pipPosition);
-        double lotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
-        double quoteToAccountRate = Symbols::GetQuoteToDepositRate(sym);
+    // M7: ComputeLotAmount clamps to min 1.0 for CFD indices
+    // Forex(10M)=1000, Gold(10K)=1, Index(100)=1 (clamped)
+    if (pLotAmount) *pLotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
 
-        *pPipCost = pip * lotAmount * quoteToAccountRate;
-    }
+    // PIPCost = PIP * LotAmount * QuoteCurrencyToAccountRate (M9: SymbolsForConversionReq for crosses)
+    if (pPipCost) *pPipCost = a.pipCost;
+    if (pMarginCost) *pMarginCost = a.marginCost;
 
-    if (pMarginCost) {
-        // M7: per-symbol margin from ExpectedMarginRes (positive = direct margin cost per lot)
-        // Zorro support confirmed: return real margin cost, NOT negative leverage
-        // Minimum threshold: 1 cent (0.01) per Zorro support
-        if (sym.marginPerLot > 0.01) {
-            *pMarginCost = sym.marginPerLot;                    // positive = direct margin per lot
-        } else if (G.leverageInCents > 0) {
-            // Fallback: calculate from global leverage using dynamic LotAmount
-            double price = sym.ask > 0.0 ? sym.ask : sym.bid;
-            double lotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
-            if (price > 0.0 && lotAmount > 0.0)
-                *pMarginCost = lotAmount * price / ((double)G.leverageInCents / 100.0);
-            else
-                *pMarginCost = 0.0;
-        } else {
-            *pMarginCost = 0.0;
-        }
-    }
-
-    // M7b: Convert swap from cTrader units to Zorro rollover format
-    if (pRollLong) *pRollLong = ConvertSwapToZorro(sym.swapLong, sym);
-    if (pRollShort) *pRollShort = ConvertSwapToZorro(sym.swapShort, sym);
+    // M7b: swap converted from cTrader units to Zorro rollover format
+    if (pRollLong) *pRollLong = a.rollLong;
+    if (pRollShort) *pRollShort = a.rollShort;
 
     G.currentSymbol = Asset;
 
     Log::Diag(2, "ASSET %s: bid=%.5f ask=%.5f LotAmt=%.1f PipCost=%.6f MCost=%.4f Roll=%.4f/%.4f Comm=%.4f",
-              Asset, sym.bid, sym.ask,
+              Asset, PriceToDouble(sym.bid), PriceToDouble(sym.ask),
               pLotAmount ? *pLotAmount : -1.0,
               pPipCost ? *pPipCost : -1.0,
               pMarginCost ? *pMarginCost : 0.0,
@@ -827,6 +950,174 @@ DLLFUNC int BrokerAsset(char* Asset, double* pPrice, double* pSpread,
     return 1;
 }
 
+// DO_PREFETCH: warm a whole asset list at once instead of one BrokerAsset round
+// trip per asset. One SubscribeSpotsReq for all symbols, all ExpectedMarginReq and
+// SymbolsForConversionReq pipelined, then a single wait for every first quote.
+// Returns the number of listed assets with a live bid and ask.
+static int PrefetchAssets(const char* list, int timeoutMs) {
+    if (!list || !*list || !G.loggedIn) return 0;
+    ULONGLONG start = GetTickCount64();
+
+    // Asset list: separated by comma, semicolon, whitespace or newline
+    std::vector<std::string> names;
+    std::vector<SymbolInfo> syms;
+    std::string token;
+    for (const char* p = list;; p++) {
+        if (*p && !strchr(",; \t\r\n", *p)) { token += *p; continue; }
+        if (!token.empty()) {
+            SymbolInfo sym;
+            if (Symbols::GetSymbol(token.c_str(), sym)) {
+                names.push_back(token);
+                syms.push_back(sym);
+            } else {
+                Log::Warn("ASSET", "Prefetch: symbol %s not found", token.c_str());
+            }
+            token.clear();
+        }
+        if (!*p) break;
+    }
+    if (syms.empty()) return 0;
+
+    Subs::UseMany(names);
+
+    // Missing contract details in one request; margin volume depends on them
+    if (!Symbols::EnsureDetails(names)) {
+        Log::Warn("ASSET", "Prefetch: contract details incomplete");
+    }
+    for (size_t i = 0; i < names.size(); i++) Symbols::GetSymbol(names[i].c_str(), syms[i]);
+
+    // Pipelined margin requests (same volume as BrokerAsset M7)
+    std::vector<std::string> pending, marginIds;
+    for (const auto& sym : syms) {
+        if (sym.marginPerLot > 0.0 || sym.symbolId <= 0) continue;
+        long long marginVolume = (long long)(ComputeLotAmount(sym.minVolume, sym.lotSize) * 100.0);
+        if (marginVolume < 1) marginVolume = 1;
+        std::string id = Symbols::RequestMarginAsync(sym.symbolId, marginVolume);
+        if (!id.empty()) {
+            pending.push_back(id);
+            marginIds.push_back(id);
+        }
+    }
+
+    // Pipelined conversion chains, one per distinct quote asset
+    std::vector<long long> requestedAssets;
+    for (const auto& sym : syms) {
+        if (!Symbols::NeedsConversionChain(sym)) continue;
+        if (std::find(requestedAssets.begin(), requestedAssets.end(), sym.quoteAssetId) != requestedAssets.end())
+            continue;
+        requestedAssets.push_back(sym.quoteAssetId);
+        std::string id = Symbols::RequestConversionChainAsync(sym.quoteAssetId);
+        if (!id.empty()) pending.push_back(id);
+    }
+
+    // Wait for all responses and first quotes together
+    std::vector<std::string> warmNames = names;
+    int warm = 0;
+    while (true) {
+        std::vector<std::string> chainSymbols;
+        Symbols::CompleteConversionChains(chainSymbols);
+        if (!chainSymbols.empty()) {
+            Symbols::SubscribeMany(chainSymbols);
+            warmNames.insert(warmNames.end(), chainSymbols.begin(), chainSymbols.end());
+        }
+
+        bool requestsDone = true;
+        for (const auto& id : pending) {
+            if (Symbols::IsRequestPending(id)) { requestsDone = false; break; }
+        }
+
+        warm = 0;
+        bool quotesDone = true;
+        for (size_t i = 0; i < warmNames.size(); i++) {
+            Quote q;
+            bool hasQuote = Symbols::GetQuote(Symbols::GetHandle(warmNames[i].c_str()), q) &&
+                            q.bid > 0 && q.ask > 0;
+            if (!hasQuote) quotesDone = false;
+            else if (i < names.size()) warm++;
+        }
+
+        if (requestsDone && quotesDone) break;
+        if (GetTickCount64() - start >= (ULONGLONG)timeoutMs) {
+            Log::Warn("ASSET", "Prefetch timeout after %dms: %d/%d assets quoted, requests %s",
+                      timeoutMs, warm, (int)names.size(), requestsDone ? "done" : "pending");
+            break;
+        }
+        Sleep(20);
+        if (BrokerProgress) BrokerProgress(1);
+    }
+    Symbols::CancelMarginRequests(marginIds);  // ids still pending after a timeout
+
+    Log::Info("ASSET", "Prefetch: %d/%d assets warm in %llums (%d requests pipelined, %d chain symbols)",
+              warm, (int)names.size(), GetTickCount64() - start, (int)pending.size(),
+              (int)(warmNames.size() - names.size()));
+    return warm;
+}
+
+// GET_ASSETSNAPSHOT: BrokerAsset values for a list of asset handles in one pass.
+// Leases renewed in one call, quotes read lock-free between two quote applies,
+// contract data read from the published symbol table without csSymbols or copies.
+// Assets whose conversion path has no quote yet take the BrokerAsset path.
+static int SnapshotAssets(AssetSnapshot* req) {
+    if (!req || !req->assets || req->count <= 0 || !G.loggedIn) return 0;
+    int n = (req->count < MAX_SYMBOLS) ? req->count : MAX_SYMBOLS;
+    AssetQuote* out = req->assets;
+
+    std::vector<int> handles(n);
+    for (int i = 0; i < n; i++) handles[i] = out[i].handle;
+    Subs::UseHandles(handles);
+
+    // Retry while a quote was applied in between (slots stay torn-free anyway)
+    std::vector<Quote> quotes(n);
+    bool consistent = false;
+    for (int attempt = 0; attempt < 8 && !consistent; attempt++) {
+        unsigned seq = Feed::ApplySeq();
+        if (seq & 1) { Sleep(0); continue; }
+        for (int i = 0; i < n; i++) {
+            if (!Symbols::GetQuote(handles[i], quotes[i])) quotes[i] = Quote();
+        }
+        consistent = (Feed::ApplySeq() == seq);
+    }
+    // Busy feed: one plain pass, quotes may straddle an apply
+    if (!consistent) {
+        for (int i = 0; i < n; i++) {
+            if (!Symbols::GetQuote(handles[i], quotes[i])) quotes[i] = Quote();
+        }
+    }
+
+    int valid = 0;
+    std::vector<int> slow;
+    std::vector<SymbolInfo> slowSyms;
+    {
+        SymTable::Reader table;
+        for (int i = 0; i < n; i++) {
+            AssetQuote& a = out[i];
+            const Quote& q = quotes[i];
+            int h = handles[i];
+            a = AssetQuote();
+            a.handle = h;
+            const SymbolInfo* rec = table->Find(h);
+            if (!rec || (q.bid <= 0 && q.ask <= 0)) continue;
+
+            const SymbolInfo& sym = *rec;
+            double qRate = 1.0;
+            if (G.depositAssetId > 0 && sym.quoteAssetId > 0 && sym.quoteAssetId != G.depositAssetId) {
+                qRate = Rates::QuoteToDeposit(h);
+                if (qRate <= 0.0) { slow.push_back(i); slowSyms.push_back(sym); continue; }
+            }
+            FillAssetQuote(a, sym, q.bid, q.ask, q.lastQuoteTime, qRate);
+            valid++;
+        }
+    }
+
+    for (size_t k = 0; k < slow.size(); k++) {
+        int i = slow[k];
+        FillAssetQuote(out[i], slowSyms[k], quotes[i].bid, quotes[i].ask, quotes[i].lastQuoteTime,
+                       Symbols::GetQuoteToDepositRate(slowSyms[k]));
+        valid++;
+    }
+    return valid;
+}
+
 DLLFUNC int BrokerAccount(char* Account, double* pBalance, double* pTradeVal,
                           double* pMarginVal) {
     if (!G.loggedIn) return 0;
@@ -929,149 +1220,6 @@ static int MinutesToPeriod(int minutes) {
     }
 }
 
-// ============================================================
-// History file cache - read/write T6 files in History\ folder
-// ============================================================
-
-// Extract year from OLE DATE
-static int OleDateToYear(DATE oleDate) {
-    SYSTEMTIME st = {0};
-    VariantTimeToSystemTime(oleDate, &st);
-    return st.wYear;
-}
-
-// Build cache filepath: History\{Asset}_{year}.t6
-static void BuildHistoryCachePath(char* out, int maxLen, const char* asset, int year) {
-    // Strip slashes from asset name: "EUR/USD" -> "EURUSD"
-    char cleanAsset[64] = {0};
-    int j = 0;
-    for (const char* p = asset; *p && j < 62; p++) {
-        if (*p != '/' && *p != '\\' && *p != ' ')
-            cleanAsset[j++] = *p;
-    }
-    cleanAsset[j] = '\0';
-    sprintf_s(out, maxLen, "History\\%s_%d.t6", cleanAsset, year);
-}
-
-// Read T6 bars from History cache file
-// Returns bars matching [tStart, tEnd] range, newest first, up to nTicks
-static int ReadHistoryCache(const char* asset, DATE tStart, DATE tEnd,
-                            int nTickMinutes, int nTicks, T6* bars) {
-    if (nTickMinutes == 0) return 0;  // no tick cache yet
-
-    int year = OleDateToYear(tEnd);
-    char path[MAX_PATH];
-    BuildHistoryCachePath(path, MAX_PATH, asset, year);
-
-    FILE* f = nullptr;
-    fopen_s(&f, path, "rb");
-    if (!f) return 0;
-
-    // Get file size to determine bar count
-    fseek(f, 0, SEEK_END);
-    long fileSize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    int totalInFile = (int)(fileSize / sizeof(T6));
-    if (totalInFile <= 0) { fclose(f); return 0; }
-
-    // Allocate temp buffer for file contents
-    int readCount = totalInFile;
-    if (readCount > 500000) readCount = 500000;  // safety limit ~16MB
-    T6* fileBars = (T6*)malloc(readCount * sizeof(T6));
-    if (!fileBars) { fclose(f); return 0; }
-
-    int nRead = (int)fread(fileBars, sizeof(T6), readCount, f);
-    fclose(f);
-
-    if (nRead <= 0) { free(fileBars); return 0; }
-
-    // File is newest-first (index 0 = newest). Filter by time range.
-    int count = 0;
-    for (int i = 0; i < nRead && count < nTicks; i++) {
-        if (fileBars[i].time >= tStart && fileBars[i].time <= tEnd) {
-            bars[count++] = fileBars[i];
-        }
-    }
-
-    free(fileBars);
-    return count;
-}
-
-// Write T6 bars to History cache file
-// ALWAYS merges with existing file data to build the largest possible dataset
-static void WriteHistoryCache(const char* asset, T6* bars, int count) {
-    if (count <= 0) return;
-
-    int year = OleDateToYear(bars[0].time);  // newest bar = index 0
-    char path[MAX_PATH];
-    BuildHistoryCachePath(path, MAX_PATH, asset, year);
-
-    // Read existing file (always, for merge)
-    FILE* existing = nullptr;
-    fopen_s(&existing, path, "rb");
-    int existingCount = 0;
-    T6* existingBars = nullptr;
-
-    if (existing) {
-        fseek(existing, 0, SEEK_END);
-        long fileSize = ftell(existing);
-        existingCount = (int)(fileSize / sizeof(T6));
-        fseek(existing, 0, SEEK_SET);
-
-        if (existingCount > 0) {
-            existingBars = (T6*)malloc(existingCount * sizeof(T6));
-            if (existingBars) {
-                int nRead = (int)fread(existingBars, sizeof(T6), existingCount, existing);
-                if (nRead != existingCount) existingCount = nRead;
-            }
-        }
-        fclose(existing);
-    }
-
-    FILE* f = nullptr;
-    fopen_s(&f, path, "wb");
-    if (!f) {
-        Log::Warn("HIST", "Cache WRITE failed: %s", path);
-        if (existingBars) free(existingBars);
-        return;
-    }
-
-    if (existingBars && existingCount > 0) {
-        // Merge: combine new bars with existing, remove duplicates
-        // Both arrays are newest-first (descending time)
-        DATE newestNew = bars[0].time;
-        DATE oldestNew = bars[count - 1].time;
-        DATE newestExisting = existingBars[0].time;
-        DATE oldestExisting = existingBars[existingCount - 1].time;
-
-        // Write newest data first, then fill in older non-overlapping data
-        if (newestNew >= newestExisting) {
-            // New data is newer — write new first, then append older existing bars
-            fwrite(bars, sizeof(T6), count, f);
-            for (int i = 0; i < existingCount; i++) {
-                if (existingBars[i].time < oldestNew) {
-                    fwrite(&existingBars[i], sizeof(T6), 1, f);
-                }
-            }
-        } else {
-            // Existing data is newer — write existing first, then append older new bars
-            fwrite(existingBars, sizeof(T6), existingCount, f);
-            for (int i = 0; i < count; i++) {
-                if (bars[i].time < oldestExisting) {
-                    fwrite(&bars[i], sizeof(T6), 1, f);
-                }
-            }
-        }
-        free(existingBars);
-    } else {
-        // No existing file - write new data
-        fwrite(bars, sizeof(T6), count, f);
-    }
-
-    fclose(f);
-}
-
 // Helper: wait for history response from NetworkThread (via shared buffer)
 static bool WaitForHistoryResponse(int timeoutMs) {
     ULONGLONG start = Utils::NowMs();
@@ -1117,7 +1265,7 @@ static int FetchRawTicks(SymbolInfo& sym, long long startMs, long long endMs,
             G.waitingForHistory = true;
         }
 
-        if (!WebSocket::Send(msg)) {
+        if (!WebSocket::Send(msg, ToInt(PayloadType::GetTickDataReq))) {
             Log::Error("HIST", "RawTicks(type=%d) send failed!", tickType);
             G.waitingForHistory = false;
             break;
@@ -1176,7 +1324,7 @@ static int FetchRawTicks(SymbolInfo& sym, long long startMs, long long endMs,
             }
 
             outTicks[totalTicks].oleTime = Utils::UnixToOle(absTimestamp);
-            outTicks[totalTicks].price = (float)((double)absPrice / PRICE_SCALE);
+            outTicks[totalTicks].price = (float)PriceToDouble(absPrice);
 
             // Debug: log first 3 BID ticks
             if (tickType == 1 && i < 3) {
@@ -1276,60 +1424,22 @@ static int FetchTickData(SymbolInfo& sym, long long startMs, long long endMs,
     return nBid;
 }
 
-DLLFUNC int BrokerHistory2(char* Asset, DATE tStart, DATE tEnd,
-                           int nTickMinutes, int nTicks, void* ticks) {
-    if (!Asset || !ticks || !G.loggedIn || nTicks <= 0) {
-        return 0;
-    }
-
-    // Try reading from History cache first (bar data only, not ticks)
-    // Only use cache if it covers enough of the requested time range,
-    // otherwise download fresh data from the API
-    if (nTickMinutes > 0) {
-        int cached = ReadHistoryCache(Asset, tStart, tEnd, nTickMinutes, nTicks, (T6*)ticks);
-        if (cached > 0) {
-            T6* cachedBars = (T6*)ticks;
-            DATE newestCached = cachedBars[0].time;          // newest (index 0)
-            DATE oldestCached = cachedBars[cached - 1].time;  // oldest (last index)
-            double requestedSpanDays = tEnd - tStart;
-            double cachedSpanDays = newestCached - oldestCached;
-            double coveragePct = (requestedSpanDays > 0.001) ? (100.0 * cachedSpanDays / requestedSpanDays) : 100.0;
-
-            // Accept cache if: filled the buffer (nTicks) OR covers >= 80% of requested span
-            if (cached >= nTicks || coveragePct >= 80.0) {
-                return cached;
-            }
-            // Fall through to API download
-        }
-    }
-
-    // Get symbol info
-    SymbolInfo sym;
-    if (!Symbols::GetSymbol(Asset, sym)) {
-        Log::Error("BROKER", "History: symbol %s not found", Asset);
-        return 0;
-    }
-
-    // Convert OLE DATE to Unix milliseconds
-    long long startMs = Utils::OleToUnix(tStart);
-    long long endMs = Utils::OleToUnix(tEnd);
-
-    // Tick data: use GetTickData API
-    if (nTickMinutes == 0) {
-        return FetchTickData(sym, startMs, endMs, nTicks, (T6*)ticks);
-    }
-
+// Fetch trendbars of [startMs, endMs] in chunks, newest first, up to nTicks.
+// *coveredFromMs: start of the span [*coveredFromMs, endMs] that was fully
+// downloaded (> endMs if none).
+static int FetchBars(SymbolInfo& sym, int nTickMinutes, long long startMs, long long endMs,
+                     int nTicks, T6* bars, long long* coveredFromMs) {
     int period = MinutesToPeriod(nTickMinutes);
-
-    T6* bars = (T6*)ticks;
     int totalBars = 0;
+    *coveredFromMs = endMs + 1;  // nothing covered yet
 
-    // Compute live spread for bar fVal (trendbars are BID-only, no ASK available)
+    // Live spread for bar fVal where no recorded spread exists (trendbars are BID-only)
     float liveSpread = 0.0f;
-    if (sym.bid > 0.0 && sym.ask > 0.0 && sym.ask > sym.bid) {
-        liveSpread = (float)(sym.ask - sym.bid);
+    if (sym.bid > 0 && sym.ask > sym.bid) {
+        liveSpread = (float)PriceToDouble(sym.ask - sym.bid);
     }
-    Log::Diag(1, "HIST Live spread for bars: %.5f (bid=%.5f ask=%.5f)", liveSpread, sym.bid, sym.ask);
+    Log::Diag(1, "HIST Live spread for bars: %.5f (bid=%.5f ask=%.5f)", liveSpread,
+              PriceToDouble(sym.bid), PriceToDouble(sym.ask));
 
     // Cap bars per chunk to keep JSON response size manageable (~150KB)
     const int MAX_BARS_PER_CHUNK = 1500;
@@ -1368,7 +1478,7 @@ DLLFUNC int BrokerHistory2(char* Asset, DATE tStart, DATE tEnd,
             G.waitingForHistory = true;
         }
 
-        if (!WebSocket::Send(msg)) {
+        if (!WebSocket::Send(msg, ToInt(PayloadType::GetTrendbarsReq))) {
             Log::Error("HIST", "Send failed!");
             G.waitingForHistory = false;
             break;
@@ -1401,6 +1511,7 @@ DLLFUNC int BrokerHistory2(char* Asset, DATE tStart, DATE tEnd,
         // Parse trendbar array
         const char* arr = Protocol::ExtractArray(G.historyResponseBuf, "trendbar");
         if (!arr || *arr == '\0' || (*arr == '[' && *(arr + 1) == ']')) {
+            *coveredFromMs = chunkStart;  // no bars in this chunk
             chunkEnd = chunkStart;
             continue;
         }
@@ -1431,10 +1542,10 @@ DLLFUNC int BrokerHistory2(char* Asset, DATE tStart, DATE tEnd,
 
             T6 bar;
             memset(&bar, 0, sizeof(T6));
-            bar.fLow   = (float)((double)low / PRICE_SCALE);
-            bar.fHigh  = (float)((double)(low + deltaHigh) / PRICE_SCALE);
-            bar.fOpen  = (float)((double)(low + deltaOpen) / PRICE_SCALE);
-            bar.fClose = (float)((double)(low + deltaClose) / PRICE_SCALE);
+            bar.fLow   = (float)PriceToDouble(low);
+            bar.fHigh  = (float)PriceToDouble(low + deltaHigh);
+            bar.fOpen  = (float)PriceToDouble(low + deltaOpen);
+            bar.fClose = (float)PriceToDouble(low + deltaClose);
             bar.fVol   = (float)volume;
             bar.fVal   = liveSpread;  // spread from live SpotEvent quotes
             bar.time   = Utils::MinutesToOle(tsMinutes);
@@ -1455,6 +1566,14 @@ DLLFUNC int BrokerHistory2(char* Asset, DATE tStart, DATE tEnd,
             bars[totalBars++] = chunkBars[i];
         }
 
+        // Covered down to the chunk start, or only to the oldest bar kept
+        // when the server or nTicks may have cut the chunk short
+        if (!chunkBars.empty() && (int)chunkBars.size() < barsNeeded && totalBars < nTicks) {
+            *coveredFromMs = chunkStart;
+        } else if (totalBars > 0) {
+            *coveredFromMs = Utils::OleToUnix(bars[totalBars - 1].time);
+        }
+
         // Move to earlier period: use oldest bar's timestamp as new chunkEnd
         long long prevChunkEnd = chunkEnd;
         if (!chunkBars.empty()) {
@@ -1470,20 +1589,141 @@ DLLFUNC int BrokerHistory2(char* Asset, DATE tStart, DATE tEnd,
         }
     }
 
-    // Write bars to History folder for local cache
-    if (totalBars > 0) {
-        WriteHistoryCache(Asset, bars, totalBars);
-    }
 
     return totalBars;
 }
 
+// Bars for BrokerHistory2: download only the parts of [tStart, tEnd] the local
+// store does not cover yet (usually the newest few bars), merge them in, then
+// serve the whole range from the store in one read
+static int HistoryBars(const char* Asset, DATE tStart, DATE tEnd, int nTickMinutes, int nTicks, T6* bars) {
+    const int MAX_GAPS = 16;
+    HistStore::Span gaps[MAX_GAPS];
+    int nGaps = HistStore::Missing(Asset, nTickMinutes, tStart, tEnd, gaps, MAX_GAPS);
+
+    SymbolInfo sym;
+    if (nGaps > 0) {
+        Symbols::EnsureDetails(Asset);
+        if (!Symbols::GetSymbol(Asset, sym)) {
+            Log::Error("BROKER", "History: symbol %s not found", Asset);
+            nGaps = 0;
+        }
+    }
+
+    // Bars opening after this are still forming and are not marked covered
+    long long periodMs = (long long)(nTickMinutes >= 43200 ? 31 * 1440 : nTickMinutes) * 60000LL;
+    long long finalToMs = Utils::NowUnixMs() - periodMs;
+
+    // Newest gap first; stop once the bars after a gap already fill nTicks
+    int fetched = 0, lastGot = 0;
+    for (int i = 0; i < nGaps; i++) {
+        int need = nTicks - HistStore::Count(Asset, nTickMinutes, gaps[i].to, tEnd);
+        if (need <= 0) break;
+
+        long long startMs = Utils::OleToUnix(gaps[i].from);
+        long long endMs = Utils::OleToUnix(gaps[i].to);
+        long long coveredFromMs = 0;
+        lastGot = FetchBars(sym, nTickMinutes, startMs, endMs, need, bars, &coveredFromMs);
+        long long coveredToMs = (endMs < finalToMs) ? endMs : finalToMs;
+        Log::Diag(1, "HIST %s: gap %d/%d %.5f..%.5f fetched %d bars", Asset, i + 1, nGaps,
+                  gaps[i].from, gaps[i].to, lastGot);
+
+        // The store keeps the bars as downloaded; recorded spreads go on the served bars
+        HistStore::Write(Asset, nTickMinutes, bars, lastGot,
+                         Utils::UnixToOle(coveredFromMs), Utils::UnixToOle(coveredToMs));
+        fetched += lastGot;
+    }
+
+    int served = HistStore::Read(Asset, nTickMinutes, tStart, tEnd, nTicks, bars);
+    if (served == 0 && lastGot > 0) served = lastGot;  // store not writable: serve the last download
+    if (served > 0) {
+        int stamped = Spread::Apply(Asset, nTickMinutes, bars, served);
+        if (stamped > 0) Log::Diag(1, "HIST %s: recorded spread on %d of %d bars", Asset, stamped, served);
+    }
+    if (fetched > 0 && served > 0) {
+        Bars::Seed(Asset, nTickMinutes, MinutesToPeriod(nTickMinutes), bars, served);
+        Indicators::Seed(sym.handle, nTickMinutes, bars, served);
+    }
+    return served;
+}
+
+DLLFUNC int BrokerHistory2(char* Asset, DATE tStart, DATE tEnd,
+                           int nTickMinutes, int nTicks, void* ticks) {
+    if (!Asset || !ticks || !G.loggedIn || nTicks <= 0) {
+        return 0;
+    }
+
+    // Recent window: live trendbar ring, no round trip
+    if (nTickMinutes > 0) {
+        int live = Bars::Read(Asset, tStart, tEnd, nTickMinutes, nTicks, (T6*)ticks);
+        if (live > 0) {
+            Spread::Apply(Asset, nTickMinutes, (T6*)ticks, live);
+            Log::Diag(1, "HIST %s: %d bars from live ring", Asset, live);
+            return live;
+        }
+        // Local history store, filling only its gaps from the API
+        return HistoryBars(Asset, tStart, tEnd, nTickMinutes, nTicks, (T6*)ticks);
+    }
+
+    // Get symbol info (digits needed for price conversion)
+    Symbols::EnsureDetails(Asset);
+    SymbolInfo sym;
+    if (!Symbols::GetSymbol(Asset, sym)) {
+        Log::Error("BROKER", "History: symbol %s not found", Asset);
+        return 0;
+    }
+
+    // Convert OLE DATE to Unix milliseconds
+    long long startMs = Utils::OleToUnix(tStart);
+    long long endMs = Utils::OleToUnix(tEnd);
+
+    // Tick data: recent tick ring first, then recorded live ticks (History\Ticks
+    // journal), GetTickData API for the rest
+    bool live = sym.subscribed && WebSocket::IsConnected();
+    long long uncoveredEndMs = endMs;
+    int recent = TickRing::Read(sym.handle, live, startMs, endMs, nTicks, (T6*)ticks, &uncoveredEndMs);
+    if (recent > 0) {
+        if (recent >= nTicks || uncoveredEndMs < startMs) {
+            Log::Diag(1, "HIST %s: %d ticks from recent ring", Asset, recent);
+            return recent;
+        }
+        // Older part appended after the ring ticks (still newest first)
+        Log::Diag(1, "HIST %s: %d ticks from recent ring, fetching the rest", Asset, recent);
+        endMs = uncoveredEndMs;
+        ticks = (T6*)ticks + recent;
+        nTicks -= recent;
+    }
+
+    // Journal serves the part its recorded spans cover, the API the older rest
+    int journaled = Journal::ReadTicks(sym.handle, sym.name.c_str(), live, startMs, endMs,
+                                       nTicks, (T6*)ticks, &uncoveredEndMs);
+    if (journaled > 0) {
+        if (journaled >= nTicks || uncoveredEndMs < startMs) {
+            Log::Diag(1, "HIST %s: %d ticks from journal", Asset, journaled);
+            return recent + journaled;
+        }
+        Log::Diag(1, "HIST %s: %d ticks from journal, fetching the rest", Asset, journaled);
+        endMs = uncoveredEndMs;
+        ticks = (T6*)ticks + journaled;
+        nTicks -= journaled;
+    }
+    return recent + journaled + FetchTickData(sym, startMs, endMs, nTicks, (T6*)ticks);
+}
+
 // Legacy BrokerHistory wrapper - Zorro may call this instead of BrokerHistory2
 DLLFUNC int BrokerHistory(char* Asset, DATE tStart, DATE tEnd,
                           int nTickMinutes, int nTicks, void* ticks) {
     return BrokerHistory2(Asset, tStart, tEnd, nTickMinutes, nTicks, ticks);
 }
 
+// SET_SYMBOL asset for the contract getters; with lazy details its contract
+// is loaded on first use here, as in BrokerAsset
+static bool CurrentSymbol(SymbolInfo& sym) {
+    if (G.currentSymbol.empty()) return false;
+    if (G.lazyDetails) Symbols::EnsureDetails(G.currentSymbol.c_str());
+    return Symbols::GetSymbol(G.currentSymbol.c_str(), sym);
+}
+
 DLLFUNC double BrokerCommand(int Command, DWORD dwParameter) {
     switch (Command) {
         case 2000: // cycled heartbeat - called on every bar cycle
@@ -1518,7 +1758,7 @@ DLLFUNC double BrokerCommand(int Command, DWORD dwParameter) {
 
         case GET_MINLOT: { // 23
             SymbolInfo sym;
-            if (G.currentSymbol.empty() || !Symbols::GetSymbol(G.currentSymbol.c_str(), sym)) return 0;
+            if (!CurrentSymbol(sym)) return 0;
             if (sym.lotSize <= 0) return 0;
             // MinLot in Zorro lots: minVolume_cents / (LotAmount * 100)
             double lotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
@@ -1530,7 +1770,7 @@ DLLFUNC double BrokerCommand(int Command, DWORD dwParameter) {
 
         case GET_LOTSTEP: { // 24
             SymbolInfo sym;
-            if (G.currentSymbol.empty() || !Symbols::GetSymbol(G.currentSymbol.c_str(), sym)) return 0;
+            if (!CurrentSymbol(sym)) return 0;
             if (sym.lotSize <= 0) return 0;
             double lotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
             return (double)sym.stepVolume / (lotAmount * 100.0);
@@ -1538,7 +1778,7 @@ DLLFUNC double BrokerCommand(int Command, DWORD dwParameter) {
 
         case GET_MAXLOT: { // 25
             SymbolInfo sym;
-            if (G.currentSymbol.empty() || !Symbols::GetSymbol(G.currentSymbol.c_str(), sym)) return 0;
+            if (!CurrentSymbol(sym)) return 0;
             if (sym.lotSize <= 0) return 0;
             double lotAmount = ComputeLotAmount(sym.minVolume, sym.lotSize);
             return (double)sym.maxVolume / (lotAmount * 100.0);
@@ -1546,7 +1786,7 @@ DLLFUNC double BrokerCommand(int Command, DWORD dwParameter) {
 
         case GET_DIGITS: { // 12 - number of digits after decimal point
             SymbolInfo sym;
-            if (G.currentSymbol.empty() || !Symbols::GetSymbol(G.currentSymbol.c_str(), sym)) return 0;
+            if (!CurrentSymbol(sym)) return 0;
             return (double)sym.digits;
         }
 
@@ -1710,15 +1950,79 @@ DLLFUNC double BrokerCommand(int Command, DWORD dwParameter) {
 
         case GET_MARGININIT: { // 29 - initial margin per lot (M7: per-symbol margin)
             SymbolInfo sym;
-            if (G.currentSymbol.empty() || !Symbols::GetSymbol(G.currentSymbol.c_str(), sym)) return 0;
+            if (!CurrentSymbol(sym)) return 0;
             // Use server margin directly (marginPerLot = margin for LotAmount=100 units)
             if (sym.marginPerLot > 0.0) return sym.marginPerLot;
             // Fallback: LotAmount * price / leverage
-            double price = sym.ask > 0.0 ? sym.ask : sym.bid;
-            if (price <= 0.0 || G.leverageInCents <= 0) return 0;
-            return 100.0 * price / ((double)G.leverageInCents / 100.0);
+            Price price = sym.ask > 0 ? sym.ask : sym.bid;
+            if (price <= 0 || G.leverageInCents <= 0) return 0;
+            return 100.0 * PriceToDouble(price) / ((double)G.leverageInCents / 100.0);
+        }
+
+        case GET_TRAFFIC: { // 2004 - per-payload traffic snapshot (last 60s window)
+            if (!dwParameter) return 0;
+            TrafficStats* ts = (TrafficStats*)dwParameter;
+            if (!Stats::GetSnapshot(ts)) return 0;
+            return ts->msgsInPerSec;
+        }
+
+        case GET_BOOK: { // 17 - order book of the SET_SYMBOL asset (T2 array, bids negative)
+            if (!dwParameter || G.currentSymbol.empty()) return 0;
+            return Book::GetBook(G.currentSymbol.c_str(), (T2*)dwParameter, 2 * Book::BOOK_LEVELS);
         }
 
+        case SET_TICKJOURNAL: // 2006 - live tick recorder on/off
+            if (dwParameter) Journal::Start();
+            else Journal::Stop();
+            return Journal::IsRunning() ? 1 : 0;
+
+        case DO_PREFETCH: // 2008 - subscribe and warm an asset list in one pass
+            return PrefetchAssets((const char*)dwParameter, 15000);
+
+        case SET_LAZYDETAILS: // 2009 - contract details on first use, from the next login
+            G.lazyDetails = (dwParameter != 0);
+            Log::Info("CMD", "Lazy symbol details %s", G.lazyDetails ? "on" : "off");
+            return 1;
+
+        case GET_DETAILCOUNT: // 2010 - symbols with contract details loaded
+            return Symbols::DetailsLoadedCount();
+
+        case SET_SUBIDLE: // 2012 - unsubscribe symbols unused for this many seconds (0 = never)
+            Subs::SetIdleTimeout((int)dwParameter);
+            Log::Info("CMD", "Spot subscription idle timeout %lus", (unsigned long)dwParameter);
+            return 1;
+
+        case SET_SPREADSTATS: // 2013 - per-minute spread recording on/off
+            Spread::Enable(dwParameter != 0);
+            return Spread::IsEnabled() ? 1 : 0;
+
+        case SET_INDICATOR: // 2014 - define a rolling indicator, returns its id
+            return Indicators::Define((const IndicatorDef*)dwParameter);
+
+        case GET_INDICATORS: // 2015 - all indicator values in one call
+            return Indicators::GetValues((double*)dwParameter);
+
+        case GET_ASSETHANDLE: { // 2016 - handle for GET_ASSETSNAPSHOT, asset warmed like BrokerAsset
+            char* asset = (char*)dwParameter;
+            double price, spread, volume, pip, pipCost, lotAmount, marginCost, rollLong, rollShort;
+            if (!asset || !BrokerAsset(asset, &price, &spread, &volume, &pip, &pipCost,
+                                       &lotAmount, &marginCost, &rollLong, &rollShort)) return -1;
+            return Symbols::GetHandle(asset);
+        }
+
+        case GET_ASSETSNAPSHOT: // 2017 - all listed assets in one pass
+            return SnapshotAssets((AssetSnapshot*)dwParameter);
+
+        case GET_QUOTESTATS: { // 2011 - per-symbol quote freshness and latency
+            if (!dwParameter) return 0;
+            QuoteStats* qs = (QuoteStats*)dwParameter;
+            if (!Health::GetStats(qs)) return 0;
+            return qs->ageMs;
+        }
+
+        case DO_BENCHMARK: // 2005 - in-process micro benchmark, results in log
+            return Bench::Run((int)dwParameter);
+
         case GET_MARGINMAINTAIN: // 30 - maintenance margin (same as init for cTrader)
             return BrokerCommand(GET_MARGININIT, dwParameter);
 
@@ -1771,6 +2075,10 @@ DLLFUNC double BrokerCommand(int Command, DWORD dwParameter) {
 DLLFUNC void BrokerLogout() {
     Log::Info("BROKER", "BrokerLogout");
     StopNetworkThread();
+    if (G.loginCompleted) SymCache::Save();
+    Spread::Flush(true);
+    HistStore::Release();
+    Journal::Stop();
     WebSocket::Disconnect();
     G.loggedIn = false;
     G.loginCompleted = false;
@@ -1779,5 +2087,9 @@ DLLFUNC void BrokerLogout() {
 DLLFUNC void BrokerClose() {
     Log::Info("BROKER", "BrokerClose");
     StopNetworkThread();
+    if (G.loginCompleted) SymCache::Save();
+    Spread::Flush(true);
+    HistStore::Release();
+    Journal::Stop();
     WebSocket::Disconnect();
 }
@@ -0,0 +1,50 @@
+#include "../include/state.h"
+#include "../include/feed.h"
+#include "../include/symbols.h"
+#include "../include/logger.h"
+
+namespace Feed {
+
+// ============================================================
+// Counters (written by the NetworkThread only)
+// ============================================================
+
+static volatile LONG64 s_in = 0;
+static volatile LONG s_applySeq = 0;
+
+// ============================================================
+// NetworkThread side
+// ============================================================
+
+void Post(int handle, long long rawBid, long long rawAsk, long long ts) {
+    if (handle < 0 || handle >= MAX_SYMBOLS) return;
+
+    InterlockedIncrement(&s_applySeq);
+    Symbols::ApplyQuote(handle, rawBid, rawAsk, ts);
+    InterlockedIncrement(&s_applySeq);
+
+    InterlockedIncrement64(&s_in);
+}
+
+unsigned ApplySeq() {
+    return (unsigned)InterlockedCompareExchange(&s_applySeq, 0, 0);
+}
+
+// ============================================================
+// Counters
+// ============================================================
+
+void LogSnapshot() {
+    static LONG64 prevIn = 0;
+    LONG64 in = s_in;
+    LONG64 dIn = in - prevIn;
+    prevIn = in;
+    if (dIn <= 0) return;
+    Log::Info("FEED", "Quotes applied: %lld", dIn);
+}
+
+void Reset() {
+    InterlockedExchange64(&s_in, 0);
+}
+
+} // namespace Feed
@@ -0,0 +1,195 @@
+#include "../include/state.h"
+#include "../include/health.h"
+#include "../include/symbols.h"
+#include "../include/stats.h"
+#include "../include/logger.h"
+#include "../include/zorro_constants.h"
+#include "../include/utils.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Health {
+
+// ============================================================
+// Counters per symbol handle (single writer: NetworkThread)
+// ============================================================
+
+struct SymbolHealth {
+    volatile LONG64 quotes;
+    volatile LONG64 lastRecvTicks;        // 0 = no SpotEvent yet
+    volatile LONG64 maxGapTicks;
+    volatile LONG64 latencyCount;
+    volatile LONG64 latencySumUs;
+    volatile LONG64 minLatencyUs;
+    volatile LONG64 windowQuotes;         // quotes in the last completed window
+    long long windowStartQuotes;          // NetworkThread only
+    volatile LONG gapHist[QUOTE_HIST_BUCKETS];
+    volatile LONG latencyHist[QUOTE_HIST_BUCKETS];
+};
+
+static SymbolHealth s_sym[MAX_SYMBOLS];
+static volatile LONG64 s_windowMs = 0;   // length of last completed window (0 = none yet)
+static ULONGLONG s_windowStartMs = 0;
+
+// Receive clock: UTC microseconds at s_baseTicks, recalibrated by Roll()
+static long long s_baseTicks = 0;
+static long long s_baseUnixUs = 0;
+
+static void Calibrate() {
+    s_baseTicks = Stats::Ticks();
+    s_baseUnixUs = Utils::NowUnixUs();
+}
+
+// Bucket 0 = below 1 ms, bucket k = [2^(k-1), 2^k) ms, last bucket open ended
+static int BucketOf(long long us) {
+    long long ms = us / 1000;
+    int b = 0;
+    while (ms > 0 && b < QUOTE_HIST_BUCKETS - 1) { ms >>= 1; b++; }
+    return b;
+}
+
+// Upper bound in ms of the bucket holding the given fraction of all samples
+static double Percentile(const volatile LONG* hist, double fraction) {
+    long long total = 0;
+    for (int b = 0; b < QUOTE_HIST_BUCKETS; b++) total += hist[b];
+    if (total == 0) return 0.0;
+    long long rank = (long long)(fraction * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    long long seen = 0;
+    for (int b = 0; b < QUOTE_HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank) return (double)(1LL << b);
+    }
+    return (double)(1LL << (QUOTE_HIST_BUCKETS - 1));
+}
+
+// ============================================================
+// Spot path
+// ============================================================
+
+void RecordQuote(int handle, long long serverMs, long long recvTicks) {
+    if (handle < 0 || handle >= MAX_SYMBOLS) return;
+    SymbolHealth& h = s_sym[handle];
+    InterlockedIncrement64(&h.quotes);
+
+    long long prev = h.lastRecvTicks;
+    InterlockedExchange64(&h.lastRecvTicks, recvTicks);
+    if (prev > 0 && recvTicks > prev) {
+        long long gap = recvTicks - prev;
+        InterlockedIncrement(&h.gapHist[BucketOf((long long)Stats::TicksToUs(gap))]);
+        if (gap > h.maxGapTicks) InterlockedExchange64(&h.maxGapTicks, gap);
+    }
+
+    if (serverMs > 0) {
+        if (s_baseTicks == 0) Calibrate();
+        long long recvUs = s_baseUnixUs + (long long)Stats::TicksToUs(recvTicks - s_baseTicks);
+        long long latUs = recvUs - serverMs * 1000;  // negative: local clock behind the server
+        InterlockedIncrement(&h.latencyHist[BucketOf(latUs)]);
+        InterlockedIncrement64(&h.latencyCount);
+        InterlockedExchangeAdd64(&h.latencySumUs, latUs);
+        if (h.latencyCount == 1 || latUs < h.minLatencyUs) InterlockedExchange64(&h.minLatencyUs, latUs);
+    }
+}
+
+// ============================================================
+// Readers
+// ============================================================
+
+static double AgeMs(const SymbolHealth& h) {
+    long long last = h.lastRecvTicks;
+    return last > 0 ? Stats::TicksToUs(Stats::Ticks() - last) / 1000.0 : -1.0;
+}
+
+bool GetStats(QuoteStats* out) {
+    if (!out) return false;
+    out->symbol[sizeof(out->symbol) - 1] = '\0';
+    int handle = Symbols::GetHandle(out->symbol);
+    if (handle < 0 || handle >= MAX_SYMBOLS) return false;
+
+    const SymbolHealth& h = s_sym[handle];
+    out->quotes = (double)h.quotes;
+    if (s_windowMs > 0) {
+        out->quotesPerSec = (double)h.windowQuotes * 1000.0 / (double)s_windowMs;
+    } else {
+        ULONGLONG ms = GetTickCount64() - s_windowStartMs;
+        out->quotesPerSec = (ms > 0) ? (double)h.quotes * 1000.0 / (double)ms : 0.0;
+    }
+    out->ageMs = AgeMs(h);
+    out->gapP50Ms = Percentile(h.gapHist, 0.50);
+    out->gapP99Ms = Percentile(h.gapHist, 0.99);
+    out->gapMaxMs = Stats::TicksToUs(h.maxGapTicks) / 1000.0;
+
+    long long n = h.latencyCount;
+    out->latencyAvgMs = n > 0 ? (double)h.latencySumUs / (double)n / 1000.0 : 0.0;
+    out->latencyMinMs = n > 0 ? (double)h.minLatencyUs / 1000.0 : 0.0;
+    out->latencyP50Ms = Percentile(h.latencyHist, 0.50);
+    out->latencyP99Ms = Percentile(h.latencyHist, 0.99);
+
+    for (int b = 0; b < QUOTE_HIST_BUCKETS; b++) {
+        out->gapHist[b] = (int)h.gapHist[b];
+        out->latencyHist[b] = (int)h.latencyHist[b];
+    }
+    return true;
+}
+
+void Roll() {
+    ULONGLONG now = GetTickCount64();
+    if (s_windowStartMs > 0) {
+        for (int i = 0; i < MAX_SYMBOLS; i++) {
+            SymbolHealth& h = s_sym[i];
+            long long q = h.quotes;
+            InterlockedExchange64(&h.windowQuotes, q - h.windowStartQuotes);
+            h.windowStartQuotes = q;
+        }
+        InterlockedExchange64(&s_windowMs, (LONG64)(now - s_windowStartMs));
+    }
+    s_windowStartMs = now;
+    Calibrate();  // follow system clock adjustments
+}
+
+void LogSnapshot() {
+    struct Sub { int handle; std::string name; };
+    std::vector<Sub> subs;
+    {
+        CsLock lock(G.csSymbols);
+        for (const auto& sym : G.symbols) {
+            if (sym.subscribed && sym.handle >= 0 && sym.handle < MAX_SYMBOLS)
+                subs.push_back({ sym.handle, sym.name });
+        }
+    }
+
+    // A symbol is stalled when its silence is far beyond its own usual gap
+    // while the feed as a whole is alive (so market close is not reported)
+    int active = 0, stalled = 0;
+    std::string names;
+    for (const auto& s : subs) {
+        const SymbolHealth& h = s_sym[s.handle];
+        double age = AgeMs(h);
+        if (age < 0.0) continue;
+        double limit = 8.0 * Percentile(h.gapHist, 0.99);
+        if (limit < 30000.0) limit = 30000.0;
+        if (age <= limit) { active++; continue; }
+        stalled++;
+        if (stalled <= 5) {
+            char buf[96];
+            sprintf_s(buf, "%s%s (%.0fs)", names.empty() ? "" : ", ", s.name.c_str(), age / 1000.0);
+            names += buf;
+        }
+    }
+    if (stalled > 0 && active > 0) {
+        Log::Warn("HEALTH", "%d of %d subscribed symbols stalled: %s%s",
+                  stalled, (int)subs.size(), names.c_str(), stalled > 5 ? ", ..." : "");
+    }
+}
+
+void Reset() {
+    memset((void*)s_sym, 0, sizeof(s_sym));
+    s_windowMs = 0;
+    s_windowStartMs = GetTickCount64();
+    s_baseTicks = 0;
+    s_baseUnixUs = 0;
+}
+
+} // namespace Health
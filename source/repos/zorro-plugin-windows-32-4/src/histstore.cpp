@@ -0,0 +1,419 @@
+#include "../include/state.h"
+#include "../include/histstore.h"
+#include "../include/logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <oleauto.h>  // VariantTimeToSystemTime
+
+namespace HistStore {
+
+// ============================================================
+// File format (.hst)
+// FileHeader, Span spans[spanCount] (covered intervals, ascending),
+// DATE index[indexCount] (time of bar k * INDEX_STRIDE), T6 bars[count]
+// ascending by time. Write() rewrites the whole block through a temp file
+// and a rename.
+// ============================================================
+
+static constexpr char MAGIC[4] = { 'C', 'T', 'H', 'S' };
+static constexpr int VERSION = 2;  // 2: covered spans
+
+struct FileHeader {
+    char magic[4];
+    int version;
+    int minutes;       // bar period
+    int block;         // yyyymm or yyyy
+    int count;         // bars
+    int indexCount;
+    int spanCount;
+    int reserved;      // keeps spans 8-byte aligned
+};
+
+static constexpr DATE SPAN_SLACK = 1.0 / 86400.0;  // 1 s: OLE doubles are not exact
+
+static long IndexOffset(const FileHeader& h) {
+    return (long)(sizeof(FileHeader) + (size_t)h.spanCount * sizeof(Span));
+}
+
+static long BarsOffset(const FileHeader& h) {
+    return IndexOffset(h) + (long)((size_t)h.indexCount * sizeof(DATE));
+}
+
+// Month (yyyymm) below H1, year (yyyy) from H1 up
+static int BlockOf(int minutes, DATE t) {
+    SYSTEMTIME st = {0};
+    VariantTimeToSystemTime(t, &st);
+    return (minutes < 60) ? st.wYear * 100 + st.wMonth : st.wYear;
+}
+
+// Block before / after this one (month or year)
+static int PrevBlock(int minutes, int block) {
+    if (minutes >= 60) return block - 1;
+    return (block % 100 == 1) ? (block / 100 - 1) * 100 + 12 : block - 1;
+}
+
+static int NextBlock(int minutes, int block) {
+    if (minutes >= 60) return block + 1;
+    return (block % 100 == 12) ? (block / 100 + 1) * 100 + 1 : block + 1;
+}
+
+// First instant of a block
+static DATE BlockStart(int minutes, int block) {
+    SYSTEMTIME st = {0};
+    st.wYear = (WORD)((minutes < 60) ? block / 100 : block);
+    st.wMonth = (WORD)((minutes < 60) ? block % 100 : 1);
+    st.wDay = 1;
+    DATE t = 0;
+    SystemTimeToVariantTime(&st, &t);
+    return t;
+}
+
+// Sort and coalesce touching or overlapping spans
+static void MergeSpans(std::vector<Span>& spans) {
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.from < b.from; });
+    size_t kept = 0;
+    for (size_t i = 0; i < spans.size(); i++) {
+        if (kept > 0 && spans[i].from <= spans[kept - 1].to + SPAN_SLACK) {
+            if (spans[i].to > spans[kept - 1].to) spans[kept - 1].to = spans[i].to;
+        } else {
+            spans[kept++] = spans[i];
+        }
+    }
+    spans.resize(kept);
+}
+
+static void PeriodLabel(char* out, int maxLen, int minutes) {
+    if (minutes == 43200) sprintf_s(out, maxLen, "MN1");
+    else if (minutes == 10080) sprintf_s(out, maxLen, "W1");
+    else if (minutes % 1440 == 0) sprintf_s(out, maxLen, "D%d", minutes / 1440);
+    else if (minutes % 60 == 0) sprintf_s(out, maxLen, "H%d", minutes / 60);
+    else sprintf_s(out, maxLen, "M%d", minutes);
+}
+
+// History\Bars\{Asset}_{period}_{block}.hst, "EUR/USD" -> "EURUSD"
+static void BuildPath(char* out, int maxLen, const char* asset, int minutes, int block) {
+    char clean[64] = {0};
+    int j = 0;
+    for (const char* p = asset; *p && j < 62; p++) {
+        if (*p != '/' && *p != '\\' && *p != ' ') clean[j++] = *p;
+    }
+    char tf[16];
+    PeriodLabel(tf, sizeof(tf), minutes);
+    sprintf_s(out, maxLen, "History\\Bars\\%s_%s_%d.hst", clean, tf, block);
+}
+
+// ============================================================
+// Mapped blocks
+// Read-only views shared by all BrokerHistory2 calls, guarded by
+// G.csHistStore. A fixed table, least recently used view evicted;
+// Write() unmaps a block before replacing it.
+// ============================================================
+
+struct Mapped {
+    char path[MAX_PATH];
+    HANDLE hFile;
+    HANDLE hMap;
+    const unsigned char* view;
+    const FileHeader* h;
+    const Span* spans;
+    const DATE* index;
+    const T6* bars;
+    ULONGLONG lastUseMs;
+};
+
+static constexpr int MAX_MAPPED = 64;
+static Mapped s_mapped[MAX_MAPPED];
+
+static void Unmap(Mapped& m) {
+    if (m.view) UnmapViewOfFile(m.view);
+    if (m.hMap) CloseHandle(m.hMap);
+    if (m.hFile && m.hFile != INVALID_HANDLE_VALUE) CloseHandle(m.hFile);
+    memset(&m, 0, sizeof(m));
+}
+
+// Caller holds csHistStore
+static void UnmapPath(const char* path) {
+    for (Mapped& m : s_mapped) {
+        if (m.view && strcmp(m.path, path) == 0) Unmap(m);
+    }
+}
+
+// Mapped block of this period, nullptr if missing or invalid. Caller holds csHistStore.
+static const Mapped* MapBlock(const char* path, int minutes) {
+    Mapped* slot = &s_mapped[0];
+    for (Mapped& m : s_mapped) {
+        if (m.view && strcmp(m.path, path) == 0) {
+            m.lastUseMs = GetTickCount64();
+            return (m.h->minutes == minutes) ? &m : nullptr;
+        }
+        if (!m.view) slot = &m;
+        else if (slot->view && m.lastUseMs < slot->lastUseMs) slot = &m;
+    }
+
+    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                               NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER size = {};
+    GetFileSizeEx(hFile, &size);
+    if (size.QuadPart < (LONGLONG)sizeof(FileHeader)) {
+        CloseHandle(hFile);
+        return nullptr;
+    }
+    HANDLE hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    const unsigned char* view = hMap ? (const unsigned char*)MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (hMap) CloseHandle(hMap);
+        CloseHandle(hFile);
+        return nullptr;
+    }
+
+    const FileHeader* h = (const FileHeader*)view;
+    bool valid = memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 && h->version == VERSION && h->count >= 0 &&
+                 h->spanCount >= 0 &&
+                 h->indexCount == (h->count + INDEX_STRIDE - 1) / INDEX_STRIDE &&
+                 size.QuadPart >= (LONGLONG)BarsOffset(*h) + (LONGLONG)h->count * (LONGLONG)sizeof(T6);
+    if (!valid) {
+        UnmapViewOfFile(view);
+        CloseHandle(hMap);
+        CloseHandle(hFile);
+        return nullptr;
+    }
+
+    if (slot->view) Unmap(*slot);
+    strcpy_s(slot->path, path);
+    slot->hFile = hFile;
+    slot->hMap = hMap;
+    slot->view = view;
+    slot->h = h;
+    slot->spans = (const Span*)(view + sizeof(FileHeader));
+    slot->index = (const DATE*)(view + IndexOffset(*h));
+    slot->bars = (const T6*)(view + BarsOffset(*h));
+    slot->lastUseMs = GetTickCount64();
+    return (h->minutes == minutes) ? slot : nullptr;
+}
+
+// First bar with time >= t (upper: time > t). The index narrows the search
+// to one stride of the mapped time column.
+static int Bound(const Mapped& m, DATE t, bool upper) {
+    const DATE* ib = m.index;
+    const DATE* ie = m.index + m.h->indexCount;
+    int k = (int)((upper ? std::upper_bound(ib, ie, t) : std::lower_bound(ib, ie, t)) - ib);
+    int lo = (k > 0) ? (k - 1) * INDEX_STRIDE + 1 : 0;
+    int hi = (k < m.h->indexCount) ? k * INDEX_STRIDE : m.h->count;
+    if (lo >= hi) return lo;
+
+    const T6* b = m.bars + lo;
+    const T6* e = m.bars + hi;
+    const T6* r = upper ? std::upper_bound(b, e, t, [](DATE v, const T6& x) { return v < x.time; })
+                        : std::lower_bound(b, e, t, [](const T6& x, DATE v) { return x.time < v; });
+    return lo + (int)(r - b);
+}
+
+// ============================================================
+// Read
+// ============================================================
+
+int Read(const char* asset, int nTickMinutes, DATE tStart, DATE tEnd, int nTicks, T6* out) {
+    if (!asset || !out || nTickMinutes <= 0 || nTicks <= 0 || tEnd < tStart) return 0;
+
+    int firstBlock = BlockOf(nTickMinutes, tStart);
+    int filled = 0;
+
+    // Newest block first, walking back until nTicks or the block of tStart;
+    // a missing block is skipped, not the end of the range
+    CsLock lock(G.csHistStore);
+    for (int block = BlockOf(nTickMinutes, tEnd); block >= firstBlock && filled < nTicks;
+         block = PrevBlock(nTickMinutes, block)) {
+        char path[MAX_PATH];
+        BuildPath(path, MAX_PATH, asset, nTickMinutes, block);
+        const Mapped* m = MapBlock(path, nTickMinutes);
+        if (!m) continue;
+
+        int first = Bound(*m, tStart, false);
+        int end = Bound(*m, tEnd, true);
+        int n = end - first;
+        if (n > nTicks - filled) n = nTicks - filled;  // newest of the range
+
+        // Straight from the view into the caller's buffer, newest first
+        const T6* src = m->bars + end - 1;
+        for (int i = 0; i < n; i++) out[filled + i] = src[-i];
+        if (n > 0) filled += n;
+    }
+    return filled;
+}
+
+int Count(const char* asset, int nTickMinutes, DATE tStart, DATE tEnd) {
+    if (!asset || nTickMinutes <= 0 || tEnd < tStart) return 0;
+
+    int firstBlock = BlockOf(nTickMinutes, tStart);
+    int total = 0;
+    CsLock lock(G.csHistStore);
+    for (int block = BlockOf(nTickMinutes, tEnd); block >= firstBlock; block = PrevBlock(nTickMinutes, block)) {
+        char path[MAX_PATH];
+        BuildPath(path, MAX_PATH, asset, nTickMinutes, block);
+        const Mapped* m = MapBlock(path, nTickMinutes);
+        if (m) total += Bound(*m, tEnd, true) - Bound(*m, tStart, false);
+    }
+    return total;
+}
+
+// ============================================================
+// Coverage
+// ============================================================
+
+int Missing(const char* asset, int nTickMinutes, DATE tStart, DATE tEnd, Span* gaps, int maxGaps) {
+    if (!asset || !gaps || maxGaps <= 0 || nTickMinutes <= 0 || tEnd < tStart) return 0;
+
+    // Covered spans of every block in the range
+    std::vector<Span> covered;
+    {
+        int lastBlock = BlockOf(nTickMinutes, tEnd);
+        CsLock lock(G.csHistStore);
+        for (int block = BlockOf(nTickMinutes, tStart); block <= lastBlock; block = NextBlock(nTickMinutes, block)) {
+            char path[MAX_PATH];
+            BuildPath(path, MAX_PATH, asset, nTickMinutes, block);
+            const Mapped* m = MapBlock(path, nTickMinutes);
+            if (m) covered.insert(covered.end(), m->spans, m->spans + m->h->spanCount);
+        }
+    }
+    MergeSpans(covered);
+
+    // [tStart, tEnd] minus the covered spans, walked newest first
+    int n = 0;
+    DATE to = tEnd;
+    for (int i = (int)covered.size() - 1; i >= 0 && n < maxGaps && to >= tStart; i--) {
+        if (covered[i].from > to) continue;
+        if (covered[i].to < to - SPAN_SLACK) gaps[n++] = { (std::max)(covered[i].to, tStart), to };
+        to = covered[i].from;
+    }
+    if (n < maxGaps && to > tStart + SPAN_SLACK) gaps[n++] = { tStart, to };
+    return n;
+}
+
+// ============================================================
+// Write
+// ============================================================
+
+// Caller holds csHistStore
+static void LoadBlock(const char* path, int minutes, std::vector<T6>& bars, std::vector<Span>& spans) {
+    const Mapped* m = MapBlock(path, minutes);
+    if (!m) return;
+    bars.assign(m->bars, m->bars + m->h->count);
+    spans.assign(m->spans, m->spans + m->h->spanCount);
+}
+
+// Merge ascending, time-unique bars and a covered span (from > to: none)
+// into one block file
+static bool WriteBlock(const char* asset, int minutes, int block, const T6* incoming, size_t count, Span span) {
+    char path[MAX_PATH], tmp[MAX_PATH];
+    BuildPath(path, MAX_PATH, asset, minutes, block);
+    sprintf_s(tmp, "%s.tmp", path);
+
+    CsLock lock(G.csHistStore);
+    std::vector<T6> stored;
+    std::vector<Span> spans;
+    LoadBlock(path, minutes, stored, spans);
+    UnmapPath(path);  // a mapped file cannot be replaced
+    if (span.from <= span.to) {
+        spans.push_back(span);
+        MergeSpans(spans);
+    }
+
+    // Both ascending; on equal time the download wins
+    std::vector<T6> merged;
+    merged.reserve(stored.size() + count);
+    size_t i = 0, j = 0;
+    while (i < stored.size() || j < count) {
+        if (j >= count || (i < stored.size() && stored[i].time < incoming[j].time)) {
+            merged.push_back(stored[i++]);
+        } else {
+            if (i < stored.size() && stored[i].time == incoming[j].time) i++;
+            merged.push_back(incoming[j++]);
+        }
+    }
+
+    FileHeader h;
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.minutes = minutes;
+    h.block = block;
+    h.count = (int)merged.size();
+    h.indexCount = (h.count + INDEX_STRIDE - 1) / INDEX_STRIDE;
+    h.spanCount = (int)spans.size();
+    h.reserved = 0;
+    std::vector<DATE> index(h.indexCount);
+    for (int k = 0; k < h.indexCount; k++) index[k] = merged[(size_t)k * INDEX_STRIDE].time;
+
+    FILE* f = nullptr;
+    fopen_s(&f, tmp, "wb");
+    if (!f) {
+        Log::Warn("HIST", "Cache WRITE failed: %s", tmp);
+        return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if (ok && h.spanCount > 0) ok = fwrite(spans.data(), sizeof(Span), spans.size(), f) == spans.size();
+    if (ok && h.indexCount > 0) ok = fwrite(index.data(), sizeof(DATE), index.size(), f) == index.size();
+    if (ok && h.count > 0) ok = fwrite(merged.data(), sizeof(T6), merged.size(), f) == merged.size();
+    fclose(f);
+    if (!ok || !MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING)) {
+        Log::Warn("HIST", "Cache WRITE failed: %s", path);
+        DeleteFileA(tmp);
+        return false;
+    }
+    Log::Diag(1, "HIST Stored %d bars in %s (%d total, %d spans)", (int)count, path, h.count, h.spanCount);
+    return true;
+}
+
+void Write(const char* asset, int nTickMinutes, const T6* bars, int count, DATE coveredFrom, DATE coveredTo) {
+    if (!asset || nTickMinutes <= 0) return;
+    if (!bars) count = 0;
+    if (count <= 0 && coveredFrom > coveredTo) return;
+
+    // Ascending and time-unique
+    std::vector<T6> incoming(bars, bars + (count > 0 ? count : 0));
+    std::stable_sort(incoming.begin(), incoming.end(),
+                     [](const T6& a, const T6& b) { return a.time < b.time; });
+    incoming.erase(std::unique(incoming.begin(), incoming.end(),
+                               [](const T6& a, const T6& b) { return a.time == b.time; }),
+                   incoming.end());
+
+    // Blocks spanned by the bars and the covered interval
+    DATE lo = (coveredFrom <= coveredTo) ? coveredFrom : incoming.front().time;
+    DATE hi = (coveredFrom <= coveredTo) ? coveredTo : incoming.back().time;
+    if (!incoming.empty()) {
+        lo = (std::min)(lo, incoming.front().time);
+        hi = (std::max)(hi, incoming.back().time);
+    }
+
+    CreateDirectoryA("History", NULL);
+    CreateDirectoryA("History\\Bars", NULL);
+
+    // Each bar goes to its own block; a download across New Year (or a
+    // month end below H1) touches several files. The covered interval is
+    // clipped to each block.
+    size_t begin = 0;
+    int lastBlock = BlockOf(nTickMinutes, hi);
+    for (int block = BlockOf(nTickMinutes, lo); block <= lastBlock; block = NextBlock(nTickMinutes, block)) {
+        DATE blockStart = BlockStart(nTickMinutes, block);
+        DATE blockEnd = BlockStart(nTickMinutes, NextBlock(nTickMinutes, block));
+        size_t end = begin;
+        while (end < incoming.size() && incoming[end].time < blockEnd) end++;
+
+        Span span = { (std::max)(coveredFrom, blockStart), (std::min)(coveredTo, blockEnd) };
+        if (end > begin || span.from <= span.to) {
+            WriteBlock(asset, nTickMinutes, block, incoming.data() + begin, end - begin, span);
+        }
+        begin = end;
+    }
+}
+
+void Release() {
+    CsLock lock(G.csHistStore);
+    for (Mapped& m : s_mapped) {
+        if (m.view) Unmap(m);
+    }
+}
+
+} // namespace HistStore
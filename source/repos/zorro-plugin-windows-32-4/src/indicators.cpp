@@ -0,0 +1,469 @@
+#include "../include/state.h"
+#include "../include/indicators.h"
+#include "../include/symbols.h"
+#include "../include/subs.h"
+#include "../include/logger.h"
+#include "../include/utils.h"
+#include "../include/zorro_constants.h"
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include <emmintrin.h>
+
+namespace Indicators {
+
+// ============================================================
+// Streams and indicators, guarded by G.csIndicators
+// ============================================================
+
+struct Bar {
+    long long bucket;   // open minute / period minutes
+    double open, high, low, close;
+};
+
+struct Stream {
+    int handle = -1;
+    int minutes = 0;
+    bool open = false;             // cur is in progress
+    Bar cur = {};
+    long long lastClosed = -1;     // bucket of the newest closed bar
+    std::vector<Bar> hist;         // closed bars, ring of HIST_BARS
+    int histHead = 0;              // oldest
+    int histCount = 0;
+    std::vector<int> members;      // indicator indices
+    int slotBegin = 0, slotEnd = 0;  // members' range in the flat arrays
+
+    Stream() : hist(HIST_BARS) {}
+
+    void Keep(const Bar& b) {
+        if (histCount < HIST_BARS) {
+            hist[(histHead + histCount++) % HIST_BARS] = b;
+        } else {
+            hist[histHead] = b;
+            histHead = (histHead + 1) % HIST_BARS;
+        }
+    }
+    const Bar& Closed(int i) const { return hist[(histHead + i) % HIST_BARS]; }  // i = 0 oldest
+};
+
+struct Indicator {
+    int type = 0;
+    int length = 0;
+    int stream = -1;
+    int slot = -1;                 // index into the flat arrays
+    long long bars = 0;            // closed bars seen
+    double prevClose = 0.0;
+    std::vector<double> window;    // SMA / variance inputs, ring of length
+    int winPos = 0;
+    std::deque<std::pair<long long, double>> extremes;  // (bar number, value), monotonic
+};
+
+static std::vector<Stream> s_streams;
+static std::vector<Indicator> s_ind;
+static std::vector<int> s_byHandle[MAX_SYMBOLS];  // stream indices
+static volatile bool s_watched[MAX_SYMBOLS];      // lock-free precheck for OnQuote
+static std::vector<int> s_closing;                // scratch of OnQuote / Tick
+static long long s_tickMinute = 0;                // csIndicators (Tick peeks unlocked)
+static int s_announced = 0;                       // ids the Zorro side knows of
+
+// Flat per-indicator arrays stepped by the SSE2 kernels, indexed by slot.
+// Each stream's indicators hold a contiguous slot range, so a bar close runs
+// the kernels over that stream's range only. A gain of 0 or equal window
+// in/out leaves an entry unchanged.
+static std::vector<double> s_rec, s_gain, s_recIn;               // EMA, ATR
+static std::vector<double> s_sum, s_sumSq, s_winIn, s_winOut;    // SMA, variance
+static std::vector<double> s_value;                              // published values (index = id - 1)
+
+// ============================================================
+// Update steps
+// ============================================================
+
+static void ClearInputs(int begin, int end) {
+    for (int k = begin; k < end; k++) s_gain[k] = s_recIn[k] = s_winIn[k] = s_winOut[k] = 0.0;
+}
+
+// rec += gain * (in - rec)
+static void StepFilters(int begin, int end) {
+    int k = begin;
+    for (; k + 2 <= end; k += 2) {
+        __m128d r = _mm_loadu_pd(&s_rec[k]);
+        __m128d d = _mm_sub_pd(_mm_loadu_pd(&s_recIn[k]), r);
+        _mm_storeu_pd(&s_rec[k], _mm_add_pd(r, _mm_mul_pd(_mm_loadu_pd(&s_gain[k]), d)));
+    }
+    for (; k < end; k++) s_rec[k] += s_gain[k] * (s_recIn[k] - s_rec[k]);
+}
+
+// sum += in - out, sumSq += in^2 - out^2
+static void StepSums(int begin, int end) {
+    int k = begin;
+    for (; k + 2 <= end; k += 2) {
+        __m128d in = _mm_loadu_pd(&s_winIn[k]);
+        __m128d out = _mm_loadu_pd(&s_winOut[k]);
+        _mm_storeu_pd(&s_sum[k], _mm_add_pd(_mm_loadu_pd(&s_sum[k]), _mm_sub_pd(in, out)));
+        __m128d sq = _mm_sub_pd(_mm_mul_pd(in, in), _mm_mul_pd(out, out));
+        _mm_storeu_pd(&s_sumSq[k], _mm_add_pd(_mm_loadu_pd(&s_sumSq[k]), sq));
+    }
+    for (; k < end; k++) {
+        s_sum[k] += s_winIn[k] - s_winOut[k];
+        s_sumSq[k] += s_winIn[k] * s_winIn[k] - s_winOut[k] * s_winOut[k];
+    }
+}
+
+// Inputs of indicator k for one closed bar; deques are updated right here
+static void Prepare(int k, const Bar& b) {
+    Indicator& ind = s_ind[k];
+    int j = ind.slot;
+    switch (ind.type) {
+        case IND_EMA:
+        case IND_ATR: {
+            double x = b.close;
+            if (ind.type == IND_ATR) {
+                x = b.high - b.low;
+                if (ind.bars > 0) {
+                    x = fmax(x, fabs(b.high - ind.prevClose));
+                    x = fmax(x, fabs(b.low - ind.prevClose));
+                }
+            }
+            // Running mean until the filter has seen length bars
+            double alpha = (ind.type == IND_EMA) ? 2.0 / (ind.length + 1) : 1.0 / ind.length;
+            double warm = 1.0 / (double)(ind.bars + 1);
+            s_gain[j] = (warm > alpha) ? warm : alpha;
+            s_recIn[j] = x;
+            ind.bars++;
+            break;
+        }
+        case IND_SMA:
+        case IND_VARIANCE: {
+            double x = b.close;
+            if (ind.type == IND_VARIANCE) {
+                if (ind.prevClose <= 0.0) break;  // first bar has no return
+                x = b.close / ind.prevClose - 1.0;
+            }
+            double& slot = ind.window[ind.winPos];
+            s_winOut[j] = (ind.bars >= ind.length) ? slot : 0.0;
+            s_winIn[j] = x;
+            slot = x;
+            ind.winPos = (ind.winPos + 1) % ind.length;
+            ind.bars++;
+            break;
+        }
+        case IND_MIN:
+        case IND_MAX: {
+            bool isMin = (ind.type == IND_MIN);
+            double x = isMin ? b.low : b.high;
+            auto& dq = ind.extremes;
+            while (!dq.empty() && (isMin ? dq.back().second >= x : dq.back().second <= x)) dq.pop_back();
+            dq.push_back(std::make_pair(ind.bars, x));
+            while (dq.front().first <= ind.bars - ind.length) dq.pop_front();
+            ind.bars++;
+            break;
+        }
+    }
+    ind.prevClose = b.close;
+}
+
+// Publish the value of indicator k after the kernels ran
+static void Finish(int k) {
+    Indicator& ind = s_ind[k];
+    int j = ind.slot;
+    double v = 0.0;
+    if (ind.bars >= ind.length) {
+        switch (ind.type) {
+            case IND_EMA:
+            case IND_ATR:
+                v = s_rec[j];
+                break;
+            case IND_SMA:
+            case IND_VARIANCE: {
+                // Exact sums once per window length against rounding drift
+                if (ind.winPos == 0) {
+                    double sum = 0.0, sumSq = 0.0;
+                    for (double x : ind.window) { sum += x; sumSq += x * x; }
+                    s_sum[j] = sum;
+                    s_sumSq[j] = sumSq;
+                }
+                double n = (double)ind.length;
+                if (ind.type == IND_SMA) v = s_sum[j] / n;
+                else v = fmax(0.0, (s_sumSq[j] - s_sum[j] * s_sum[j] / n) / (n - 1.0));
+                break;
+            }
+            case IND_MIN:
+            case IND_MAX:
+                v = ind.extremes.front().second;
+                break;
+        }
+    }
+    s_value[k] = v;
+}
+
+static void Restart(int k) {
+    Indicator& ind = s_ind[k];
+    ind.bars = 0;
+    ind.prevClose = 0.0;
+    ind.window.assign(ind.length, 0.0);
+    ind.winPos = 0;
+    ind.extremes.clear();
+    s_rec[ind.slot] = s_sum[ind.slot] = s_sumSq[ind.slot] = 0.0;
+    s_value[k] = 0.0;
+}
+
+// Recompute indicator k from the closed bars of its stream
+static void Replay(int k) {
+    Restart(k);
+    const Stream& s = s_streams[s_ind[k].stream];
+    int j = s_ind[k].slot;
+    for (int i = 0; i < s.histCount; i++) {
+        ClearInputs(j, j + 1);
+        Prepare(k, s.Closed(i));
+        StepFilters(j, j + 1);
+        StepSums(j, j + 1);
+        Finish(k);
+    }
+}
+
+// Close the current bar of the listed streams; the kernels run over each
+// stream's own slot range, so the cost is the closing stream's indicators
+static void CloseBars(const std::vector<int>& closing) {
+    for (int si : closing) {
+        Stream& s = s_streams[si];
+        s.Keep(s.cur);
+        s.lastClosed = s.cur.bucket;
+        s.open = false;
+        ClearInputs(s.slotBegin, s.slotEnd);
+        for (int k : s.members) Prepare(k, s.cur);
+        StepFilters(s.slotBegin, s.slotEnd);
+        StepSums(s.slotBegin, s.slotEnd);
+        for (int k : s.members) Finish(k);
+    }
+}
+
+// Give every stream a contiguous slot range, keeping the filter and sum
+// state of existing indicators (Define only)
+static void Relayout() {
+    std::vector<int> from;  // new slot -> old slot
+    from.reserve(s_ind.size());
+    for (Stream& s : s_streams) {
+        s.slotBegin = (int)from.size();
+        for (int k : s.members) {
+            from.push_back(s_ind[k].slot);
+            s_ind[k].slot = (int)from.size() - 1;
+        }
+        s.slotEnd = (int)from.size();
+    }
+    for (auto* v : { &s_rec, &s_sum, &s_sumSq }) {
+        std::vector<double> old(*v);
+        for (size_t i = 0; i < from.size(); i++) (*v)[i] = old[from[i]];
+    }
+}
+
+static int FindStream(int handle, int minutes) {
+    for (int si : s_byHandle[handle]) {
+        if (s_streams[si].minutes == minutes) return si;
+    }
+    return -1;
+}
+
+static int AddStream(int handle, int minutes) {
+    s_streams.emplace_back();
+    s_streams.back().handle = handle;
+    s_streams.back().minutes = minutes;
+    int si = (int)s_streams.size() - 1;
+    s_byHandle[handle].push_back(si);
+    s_watched[handle] = true;
+    return si;
+}
+
+// Caller holds csIndicators
+static void TickLocked(long long minute) {
+    if (minute == s_tickMinute) return;
+    s_tickMinute = minute;
+    s_closing.clear();
+    for (int si = 0; si < (int)s_streams.size(); si++) {
+        const Stream& s = s_streams[si];
+        if (s.open && minute / s.minutes > s.cur.bucket) s_closing.push_back(si);
+    }
+    CloseBars(s_closing);
+}
+
+// One second of grace for quotes stamped just before the boundary
+static long long TickMinute() {
+    return (Utils::NowUnixMs() - 1000) / 60000;
+}
+
+// Bars are aligned to UTC midnight: periods must divide a day
+static bool ValidPeriod(int minutes) {
+    return minutes > 0 && minutes <= 1440 && 1440 % minutes == 0;
+}
+
+// ============================================================
+// Zorro thread
+// ============================================================
+
+int Define(const IndicatorDef* def) {
+    if (!def) return 0;
+    char symbol[sizeof(def->symbol) + 1];
+    memcpy(symbol, def->symbol, sizeof(def->symbol));
+    symbol[sizeof(def->symbol)] = '\0';
+
+    int handle = Symbols::GetHandle(symbol);
+    int minLength = (def->type == IND_VARIANCE) ? 2 : 1;
+    if (handle < 0 || handle >= MAX_SYMBOLS || !ValidPeriod(def->minutes) ||
+        def->type < IND_EMA || def->type > IND_MAX ||
+        def->length < minLength || def->length > HIST_BARS) {
+        Log::Warn("IND", "Invalid indicator: %s M%d type=%d length=%d",
+                  symbol, def->minutes, def->type, def->length);
+        return 0;
+    }
+
+    // Bars are built from this symbol's quotes
+    Subs::Use(symbol);
+
+    CsLock lock(G.csIndicators);
+    int si = FindStream(handle, def->minutes);
+    if (si >= 0) {
+        for (int k : s_streams[si].members) {
+            if (s_ind[k].type == def->type && s_ind[k].length == def->length) return k + 1;
+        }
+    }
+    if ((int)s_ind.size() >= MAX_INDICATORS) {
+        Log::Warn("IND", "Indicator limit %d reached", MAX_INDICATORS);
+        return 0;
+    }
+    if (si < 0) si = AddStream(handle, def->minutes);
+
+    Indicator ind;
+    ind.type = def->type;
+    ind.length = def->length;
+    ind.stream = si;
+    ind.slot = (int)s_ind.size();
+    s_ind.push_back(ind);
+    int k = (int)s_ind.size() - 1;
+    for (auto* v : { &s_rec, &s_gain, &s_recIn, &s_sum, &s_sumSq, &s_winIn, &s_winOut, &s_value })
+        v->resize(s_ind.size(), 0.0);
+    s_streams[si].members.push_back(k);
+    Relayout();
+    Replay(k);
+    if (k + 1 > s_announced) s_announced = k + 1;
+
+    Log::Diag(1, "IND #%d %s M%d type=%d length=%d (%d bars replayed)",
+              k + 1, symbol, def->minutes, def->type, def->length, s_streams[si].histCount);
+    return k + 1;
+}
+
+int GetValues(double* out) {
+    CsLock lock(G.csIndicators);
+    TickLocked(TickMinute());
+    int n = (int)s_value.size();
+    if (!out) {
+        s_announced = n;
+        return n;
+    }
+    // Never more than the caller was told about
+    int copy = (n < s_announced) ? n : s_announced;
+    if (copy > 0) memcpy(out, s_value.data(), copy * sizeof(double));
+    return copy;
+}
+
+void Seed(int handle, int nTickMinutes, const T6* bars, int count) {
+    if (handle < 0 || handle >= MAX_SYMBOLS || !bars || count <= 0 || !ValidPeriod(nTickMinutes)) return;
+
+    long long nowBucket = Utils::NowUnixMs() / 60000 / nTickMinutes;
+    long long newestBucket = (Utils::OleToUnix(bars[0].time) + 30000) / 60000 / nTickMinutes;
+    if (newestBucket < nowBucket - 1) return;  // does not reach the present
+
+    CsLock lock(G.csIndicators);
+    int si = FindStream(handle, nTickMinutes);
+    if (si < 0) return;  // no indicator on it: no ring, and OnQuote stays lock-free
+    Stream& s = s_streams[si];
+
+    s.histHead = s.histCount = 0;
+    s.lastClosed = -1;
+    int n = (count < HIST_BARS + 1) ? count : HIST_BARS + 1;
+    for (int i = n - 1; i >= 0; i--) {
+        Bar b;
+        b.bucket = (Utils::OleToUnix(bars[i].time) + 30000) / 60000 / nTickMinutes;
+        b.open = bars[i].fOpen;
+        b.high = bars[i].fHigh;
+        b.low = bars[i].fLow;
+        b.close = bars[i].fClose;
+        if (b.bucket < nowBucket) {
+            s.Keep(b);
+            s.lastClosed = b.bucket;
+        } else if (s.open && s.cur.bucket == b.bucket) {
+            // In-progress bar: keep what live quotes already added
+            if (b.high > s.cur.high) s.cur.high = b.high;
+            if (b.low < s.cur.low) s.cur.low = b.low;
+            s.cur.open = b.open;
+        } else {
+            s.cur = b;
+            s.open = true;
+        }
+    }
+    if (s.open && s.cur.bucket <= s.lastClosed) s.open = false;
+
+    for (int k : s.members) Replay(k);
+}
+
+void CountStreams(std::vector<int>& refs) {
+    CsLock lock(G.csIndicators);
+    for (const Stream& s : s_streams) {
+        if (!s.members.empty() && s.handle < (int)refs.size()) refs[s.handle]++;
+    }
+}
+
+// ============================================================
+// NetworkThread
+// ============================================================
+
+void OnQuote(int handle, double bid, long long serverMs) {
+    if (handle < 0 || handle >= MAX_SYMBOLS || !s_watched[handle] || bid <= 0.0 || serverMs <= 0) return;
+    long long minute = serverMs / 60000;
+
+    CsLock lock(G.csIndicators);
+    s_closing.clear();
+    for (int si : s_byHandle[handle]) {
+        const Stream& s = s_streams[si];
+        if (s.open && minute / s.minutes > s.cur.bucket) s_closing.push_back(si);
+    }
+    CloseBars(s_closing);
+
+    for (int si : s_byHandle[handle]) {
+        Stream& s = s_streams[si];
+        long long bucket = minute / s.minutes;
+        if (bucket <= s.lastClosed) continue;  // late quote of a closed bar
+        if (!s.open) {
+            s.cur.bucket = bucket;
+            s.cur.open = bid;
+            s.cur.high = bid;
+            s.cur.low = bid;
+            s.open = true;
+        } else {
+            if (bid > s.cur.high) s.cur.high = bid;
+            if (bid < s.cur.low) s.cur.low = bid;
+        }
+        s.cur.close = bid;
+    }
+}
+
+void Tick() {
+    long long minute = TickMinute();
+    if (minute == s_tickMinute) return;  // unlocked peek, checked again below
+    CsLock lock(G.csIndicators);
+    TickLocked(minute);
+}
+
+void Reset() {
+    CsLock lock(G.csIndicators);
+    s_streams.clear();
+    s_ind.clear();
+    for (int h = 0; h < MAX_SYMBOLS; h++) s_byHandle[h].clear();
+    memset((void*)s_watched, 0, sizeof(s_watched));
+    s_closing.clear();
+    s_tickMinute = 0;
+    s_announced = 0;
+    for (auto* v : { &s_rec, &s_gain, &s_recIn, &s_sum, &s_sumSq, &s_winIn, &s_winOut, &s_value })
+        v->clear();
+}
+
+} // namespace Indicators
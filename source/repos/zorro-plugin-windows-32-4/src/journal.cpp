@@ -0,0 +1,611 @@
+#include "../include/state.h"
+#include "../include/journal.h"
+#include "../include/symbols.h"
+#include "../include/logger.h"
+#include "../include/utils.h"
+#include "../include/symtable.h"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <process.h>
+
+namespace Journal {
+
+// ============================================================
+// File format (.ctj)
+// 128-byte header, then one varint record per quote:
+//   zigzag(recvUs - prev) zigzag(serverMs - prev) zigzag(bid - prev) zigzag(ask - prev)
+// The first record of a file is relative to 0. The header carries the
+// last values so a restarted writer continues the delta chain, and
+// dataBytes so readers only decode complete records.
+// Version 2 adds the spans recorded without a break (server time, newest
+// last). A version 1 file has none, so it never claims coverage.
+// ============================================================
+
+static constexpr char MAGIC[4] = { 'C', 'T', 'J', '1' };
+static constexpr int VERSION = 2;
+static constexpr int HEADER_SIZE = 128;
+static constexpr long long CHUNK_BYTES = 1024 * 1024;   // file/mapping growth step
+static constexpr int MAX_RECORD_BYTES = 4 * 10;          // 4 varints, 10 bytes max each
+static constexpr int MAX_SPANS = 3;                      // oldest dropped when full
+static constexpr long long DAY_MS = 86400000;
+
+struct Span {
+    long long fromMs;
+    long long toMs;
+};
+
+struct FileHeader {
+    char magic[4];
+    int version;
+    long long symbolId;
+    int day;                  // Unix day (UTC)
+    int spanCount;            // was reserved (0) in version 1
+    long long dataBytes;      // valid record bytes after the header
+    long long count;
+    long long lastRecvUs;
+    long long lastServerMs;
+    long long lastBid;
+    long long lastAsk;
+    Span spans[MAX_SPANS];
+};
+static_assert(sizeof(FileHeader) <= HEADER_SIZE, "journal header too large");
+
+// ============================================================
+// SPSC ring: NetworkThread -> recorder thread
+// ============================================================
+
+struct TickRecord {
+    int handle;
+    LONG gen;                 // break generation when received
+    long long symbolId;
+    long long recvUs;         // local receive time, Unix microseconds
+    long long serverMs;
+    long long bid;
+    long long ask;
+};
+
+static constexpr unsigned RING_SIZE = 65536;  // power of two, ~2.5MB
+static TickRecord s_ring[RING_SIZE];
+static std::atomic<unsigned> s_head{0};       // written by producer
+static std::atomic<unsigned> s_tail{0};       // written by consumer
+static volatile LONG64 s_dropped = 0;
+static volatile LONG64 s_written = 0;
+
+static volatile bool s_running = false;
+static HANDLE s_thread = NULL;
+
+// ============================================================
+// Break generations
+// Break() bumps the symbol's generation; every record carries the generation
+// it was received under, so the recorder ends the span exactly between the
+// last quote before the break and the first one after it.
+// ============================================================
+
+static volatile LONG s_breakGen[MAX_SYMBOLS];
+static volatile LONG s_breakAllGen = 0;
+
+// Open span per symbol, published by the recorder for readers:
+// 0 = none, else (day + 1) << 32 | generation
+static volatile LONG64 s_open[MAX_SYMBOLS];
+
+static LONG Gen(int handle) {
+    return s_breakAllGen + s_breakGen[handle];
+}
+
+void Break(int handle) {
+    if (handle >= 0 && handle < MAX_SYMBOLS) InterlockedIncrement(&s_breakGen[handle]);
+}
+
+void BreakAll() {
+    InterlockedIncrement(&s_breakAllGen);
+}
+
+void Record(int handle, long long symbolId, long long serverMs, long long rawBid, long long rawAsk) {
+    if (!s_running || handle < 0 || handle >= MAX_SYMBOLS) return;
+
+    unsigned head = s_head.load(std::memory_order_relaxed);
+    if (head - s_tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        InterlockedIncrement64(&s_dropped);  // recorder fell behind: never block the NetworkThread
+        Break(handle);                       // the span must not bridge the lost quote
+        return;
+    }
+    TickRecord& r = s_ring[head & (RING_SIZE - 1)];
+    r.handle = handle;
+    r.gen = Gen(handle);
+    r.symbolId = symbolId;
+    r.recvUs = Utils::NowUnixUs();
+    r.serverMs = serverMs;
+    r.bid = rawBid;
+    r.ask = rawAsk;
+    s_head.store(head + 1, std::memory_order_release);
+}
+
+// ============================================================
+// Varint coding
+// ============================================================
+
+static int PutVarint(unsigned char* p, long long v) {
+    unsigned long long z = ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);  // zigzag
+    int n = 0;
+    while (z >= 0x80) {
+        p[n++] = (unsigned char)(z | 0x80);
+        z >>= 7;
+    }
+    p[n++] = (unsigned char)z;
+    return n;
+}
+
+// Returns bytes consumed, 0 on truncated input
+static int GetVarint(const unsigned char* p, const unsigned char* end, long long* v) {
+    unsigned long long z = 0;
+    int shift = 0, n = 0;
+    while (p + n < end && shift < 64) {
+        unsigned char b = p[n++];
+        z |= (unsigned long long)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = (long long)(z >> 1) ^ -(long long)(z & 1);
+            return n;
+        }
+        shift += 7;
+    }
+    return 0;
+}
+
+// ============================================================
+// Paths
+// ============================================================
+
+// History\Ticks\{Symbol}_{YYYYMMDD}.ctj (symbol stripped like the bar cache)
+static void BuildJournalPath(char* out, int maxLen, const char* symbolName, int day) {
+    char clean[64] = {0};
+    int j = 0;
+    for (const char* p = symbolName; *p && j < 62; p++) {
+        if (*p != '/' && *p != '\\' && *p != ' ')
+            clean[j++] = *p;
+    }
+    clean[j] = '\0';
+
+    time_t t = (time_t)day * 86400;
+    struct tm tmv;
+    gmtime_s(&tmv, &t);
+    sprintf_s(out, maxLen, "History\\Ticks\\%s_%04d%02d%02d.ctj",
+              clean, tmv.tm_year + 1900, tmv.tm_mon + 1, tmv.tm_mday);
+}
+
+// ============================================================
+// Memory-mapped writer (recorder thread only)
+// ============================================================
+
+struct Writer {
+    long long symbolId = 0;
+    int day = -1;
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    HANDLE hMap = NULL;
+    unsigned char* view = nullptr;
+    long long capacity = 0;
+    bool spanOpen = false;    // last span of the header is still being extended
+    LONG spanGen = 0;
+
+    FileHeader* Header() { return (FileHeader*)view; }
+};
+
+static bool MapWriter(Writer& w, long long capacity) {
+    w.hMap = CreateFileMappingA(w.hFile, NULL, PAGE_READWRITE,
+                                (DWORD)(capacity >> 32), (DWORD)(capacity & 0xFFFFFFFF), NULL);
+    if (!w.hMap) return false;
+    w.view = (unsigned char*)MapViewOfFile(w.hMap, FILE_MAP_WRITE, 0, 0, (size_t)capacity);
+    if (!w.view) {
+        CloseHandle(w.hMap);
+        w.hMap = NULL;
+        return false;
+    }
+    w.capacity = capacity;
+    return true;
+}
+
+static void UnmapWriter(Writer& w) {
+    if (w.view) UnmapViewOfFile(w.view);
+    if (w.hMap) CloseHandle(w.hMap);
+    w.view = nullptr;
+    w.hMap = NULL;
+}
+
+// Unmap and trim the file to its valid length
+static void CloseWriter(Writer& w) {
+    if (w.hFile == INVALID_HANDLE_VALUE) return;
+    long long used = w.view ? HEADER_SIZE + w.Header()->dataBytes : 0;
+    UnmapWriter(w);
+    if (used > 0) {
+        LARGE_INTEGER pos;
+        pos.QuadPart = used;
+        SetFilePointerEx(w.hFile, pos, NULL, FILE_BEGIN);
+        SetEndOfFile(w.hFile);
+    }
+    CloseHandle(w.hFile);
+    w.hFile = INVALID_HANDLE_VALUE;
+    w.day = -1;
+    w.spanOpen = false;
+}
+
+static bool OpenWriter(Writer& w, long long symbolId, int day) {
+    const char* name = Symbols::GetNameById(symbolId);
+    if (!name || !*name) return false;
+
+    char path[MAX_PATH];
+    BuildJournalPath(path, MAX_PATH, name, day);
+
+    w.hFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                          NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (w.hFile == INVALID_HANDLE_VALUE) {
+        Log::Warn("TICKS", "Cannot open journal %s (err=%lu)", path, GetLastError());
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+    GetFileSizeEx(w.hFile, &size);
+    bool fresh = size.QuadPart < HEADER_SIZE;
+    long long capacity = fresh ? CHUNK_BYTES : size.QuadPart + CHUNK_BYTES;
+
+    if (!MapWriter(w, capacity)) {
+        Log::Warn("TICKS", "Cannot map journal %s (err=%lu)", path, GetLastError());
+        CloseHandle(w.hFile);
+        w.hFile = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    FileHeader* h = w.Header();
+    if (fresh || memcmp(h->magic, MAGIC, 4) != 0) {
+        if (!fresh) Log::Warn("TICKS", "Bad journal header, restarting %s", path);
+        memset(w.view, 0, HEADER_SIZE);
+        memcpy(h->magic, MAGIC, 4);
+        h->symbolId = symbolId;
+        h->day = day;
+    }
+    if (h->version < VERSION) h->spanCount = 0;  // version 1 reserved field
+    h->version = VERSION;
+    w.symbolId = symbolId;
+    w.day = day;
+    w.spanOpen = false;
+    return true;
+}
+
+// Start a span at fromMs; the oldest span makes room when the header is full
+static void OpenSpan(Writer& w, long long fromMs, LONG gen) {
+    FileHeader* h = w.Header();
+    if (h->spanCount >= MAX_SPANS) {
+        memmove(&h->spans[0], &h->spans[1], (MAX_SPANS - 1) * sizeof(Span));
+        h->spanCount = MAX_SPANS - 1;
+    }
+    h->spans[h->spanCount] = { fromMs, fromMs };
+    MemoryBarrier();
+    h->spanCount++;
+    w.spanOpen = true;
+    w.spanGen = gen;
+}
+
+static void ExtendSpan(Writer& w, long long toMs) {
+    Span& s = w.Header()->spans[w.Header()->spanCount - 1];
+    if (toMs > s.toMs) s.toMs = toMs;
+}
+
+static bool Append(Writer& w, const TickRecord& r) {
+    FileHeader* h = w.Header();
+    unsigned char buf[MAX_RECORD_BYTES];
+    int n = 0;
+    n += PutVarint(buf + n, r.recvUs - h->lastRecvUs);
+    n += PutVarint(buf + n, r.serverMs - h->lastServerMs);
+    n += PutVarint(buf + n, r.bid - h->lastBid);
+    n += PutVarint(buf + n, r.ask - h->lastAsk);
+
+    if (HEADER_SIZE + h->dataBytes + n > w.capacity) {
+        long long grow = w.capacity + CHUNK_BYTES;
+        UnmapWriter(w);
+        if (!MapWriter(w, grow)) {
+            Log::Warn("TICKS", "Journal grow to %lld bytes failed (err=%lu)", grow, GetLastError());
+            return false;
+        }
+        h = w.Header();
+    }
+
+    memcpy(w.view + HEADER_SIZE + h->dataBytes, buf, n);
+    h->lastRecvUs = r.recvUs;
+    h->lastServerMs = r.serverMs;
+    h->lastBid = r.bid;
+    h->lastAsk = r.ask;
+    h->count++;
+    MemoryBarrier();
+    h->dataBytes += n;  // publish last: readers never see a partial record
+    return true;
+}
+
+// ============================================================
+// Recorder thread
+// ============================================================
+
+static unsigned __stdcall RecorderThread(void*) {
+    // Writers by symbol handle, created on first tick of a symbol
+    std::vector<Writer*> writers(MAX_SYMBOLS, nullptr);
+    LONG64 reportedDrops = 0;
+    ULONGLONG lastReportMs = GetTickCount64();
+
+    for (;;) {
+        unsigned tail = s_tail.load(std::memory_order_relaxed);
+        unsigned head = s_head.load(std::memory_order_acquire);
+
+        if (tail == head) {
+            if (!s_running) break;  // ring drained after Stop()
+            Sleep(5);
+        }
+
+        for (; tail != head; tail++) {
+            const TickRecord& r = s_ring[tail & (RING_SIZE - 1)];
+            int handle = r.handle;
+            if (r.serverMs > 0) {
+                Writer*& w = writers[handle];
+                if (!w) w = new Writer();
+
+                int day = (int)(r.serverMs / DAY_MS);
+                if (w->day != day) {
+                    // An unbroken span runs on across midnight into the next file
+                    bool carry = w->view && w->spanOpen && w->spanGen == r.gen && day == w->day + 1;
+                    if (carry) ExtendSpan(*w, (long long)day * DAY_MS - 1);
+                    CloseWriter(*w);
+                    if (!OpenWriter(*w, r.symbolId, day)) w->day = day;  // retry next day, not every tick
+                    else if (carry) OpenSpan(*w, (long long)day * DAY_MS, r.gen);
+                }
+                if (w->view) {
+                    if (!w->spanOpen || w->spanGen != r.gen) OpenSpan(*w, r.serverMs, r.gen);
+                    if (Append(*w, r)) {
+                        ExtendSpan(*w, r.serverMs);
+                        InterlockedIncrement64(&s_written);
+                    } else {
+                        w->spanOpen = false;
+                    }
+                }
+                LONG64 open = w->spanOpen ? ((LONG64)(w->day + 1) << 32) | (unsigned)w->spanGen : 0;
+                if (s_open[handle] != open) InterlockedExchange64(&s_open[handle], open);
+            }
+        }
+        s_tail.store(tail, std::memory_order_release);
+
+        // Report drops at most once per minute
+        if (GetTickCount64() - lastReportMs >= 60000) {
+            LONG64 dropped = s_dropped;
+            if (dropped != reportedDrops) {
+                Log::Warn("TICKS", "Journal ring overflow: %lld quotes dropped", dropped - reportedDrops);
+                reportedDrops = dropped;
+            }
+            lastReportMs = GetTickCount64();
+        }
+    }
+
+    for (int h = 0; h < MAX_SYMBOLS; h++) InterlockedExchange64(&s_open[h], 0);
+    for (Writer* w : writers) {
+        if (!w) continue;
+        CloseWriter(*w);
+        delete w;
+    }
+    SymTable::ReleaseThread();
+    return 0;
+}
+
+void Start() {
+    if (s_thread) return;
+    CreateDirectoryA("History", NULL);
+    CreateDirectoryA("History\\Ticks", NULL);
+
+    s_tail.store(s_head.load());
+    s_running = true;
+    s_thread = (HANDLE)_beginthreadex(NULL, 0, RecorderThread, NULL, 0, NULL);
+    if (!s_thread) {
+        s_running = false;
+        Log::Error("TICKS", "Recorder thread start failed");
+        return;
+    }
+    SetThreadPriority(s_thread, THREAD_PRIORITY_BELOW_NORMAL);
+    Log::Info("TICKS", "Tick journal started (History\\Ticks)");
+}
+
+void Stop() {
+    if (!s_thread) return;
+    s_running = false;
+    WaitForSingleObject(s_thread, INFINITE);  // files are trimmed and closed on the way out
+    CloseHandle(s_thread);
+    s_thread = NULL;
+    Log::Info("TICKS", "Tick journal stopped: %lld quotes written, %lld dropped",
+              (long long)s_written, (long long)s_dropped);
+}
+
+bool IsRunning() {
+    return s_running;
+}
+
+// ============================================================
+// Reader
+// Decoded days stay cached: a closed day is read once, the day the recorder
+// is still writing only has its new tail decoded on the next call.
+// ============================================================
+
+struct JournalTick {
+    long long serverMs;
+    long long bid;
+    long long ask;
+};
+
+struct Day {
+    std::string path;
+    int day = 0;
+    bool closed = false;          // no writer can append any more
+    long long decoded = 0;        // data bytes decoded so far
+    long long v[4] = {};          // delta chain: recvUs, serverMs, bid, ask
+    int spanCount = 0;
+    Span spans[MAX_SPANS] = {};
+    std::vector<JournalTick> ticks;
+    ULONGLONG lastUse = 0;
+};
+
+static constexpr int MAX_CACHED_DAYS = 8;
+static std::vector<Day*> s_days;  // csJournal
+
+// Decode the complete records in [p, end); returns bytes consumed
+static long long Decode(Day& d, const unsigned char* p, const unsigned char* end) {
+    const unsigned char* start = p;
+    while (p < end) {
+        long long delta[4];
+        int used = 0;
+        for (int k = 0; k < 4; k++) {
+            int n = GetVarint(p + used, end, &delta[k]);
+            if (n == 0) return p - start;  // truncated tail
+            used += n;
+        }
+        p += used;
+        for (int k = 0; k < 4; k++) d.v[k] += delta[k];
+        d.ticks.push_back(JournalTick{ d.v[1], d.v[2], d.v[3] });
+    }
+    return p - start;
+}
+
+// Bring one day file up to date. Safe while the recorder is appending to it.
+// Caller holds csJournal.
+static const Day* LoadDayLocked(int handle, const char* symbolName, int day) {
+    char path[MAX_PATH];
+    BuildJournalPath(path, MAX_PATH, symbolName, day);
+
+    Day* d = nullptr;
+    for (Day* c : s_days) {
+        if (c->day == day && c->path == path) { d = c; break; }
+    }
+    if (d && d->closed) {
+        d->lastUse = GetTickCount64();
+        return d;
+    }
+
+    FILE* f = nullptr;
+    fopen_s(&f, path, "rb");
+    if (!f) return nullptr;
+
+    FileHeader h;
+    unsigned char hbuf[HEADER_SIZE];
+    bool ok = fread(hbuf, 1, HEADER_SIZE, f) == HEADER_SIZE;
+    memcpy(&h, hbuf, sizeof(h));
+    ok = ok && memcmp(h.magic, MAGIC, 4) == 0 && h.dataBytes >= 0;
+    if (!ok) { fclose(f); return nullptr; }
+
+    if (!d) {
+        if ((int)s_days.size() >= MAX_CACHED_DAYS) {
+            auto lru = s_days.begin();
+            for (auto it = s_days.begin(); it != s_days.end(); ++it)
+                if ((*it)->lastUse < (*lru)->lastUse) lru = it;
+            delete *lru;
+            s_days.erase(lru);
+        }
+        d = new Day();
+        d->path = path;
+        d->day = day;
+        s_days.push_back(d);
+    }
+    if (h.dataBytes < d->decoded) {  // file restarted
+        d->decoded = 0;
+        memset(d->v, 0, sizeof(d->v));
+        d->ticks.clear();
+    }
+
+    // The recorder is done with a day once the clock and its own writer moved on
+    LONG64 open = s_open[handle];
+    long long nowDay = (Utils::NowUnixMs() - 60000) / DAY_MS;  // a minute of grace for late quotes
+    bool closed = day < nowDay && (open == 0 || (int)((open >> 32) - 1) != day);
+
+    if (h.dataBytes > d->decoded) {
+        std::vector<unsigned char> data((size_t)(h.dataBytes - d->decoded));
+        _fseeki64(f, HEADER_SIZE + d->decoded, SEEK_SET);
+        size_t nRead = fread(data.data(), 1, data.size(), f);
+        d->decoded += Decode(*d, data.data(), data.data() + nRead);
+    }
+    fclose(f);
+
+    d->spanCount = (h.version >= VERSION) ? h.spanCount : 0;
+    if (d->spanCount < 0 || d->spanCount > MAX_SPANS) d->spanCount = 0;
+    memcpy(d->spans, h.spans, sizeof(d->spans));
+    d->closed = closed;
+    d->lastUse = GetTickCount64();
+    return d;
+}
+
+// Span of this day file containing ms; liveEnd extends its newest span to now
+static const Span* FindSpan(const Day* d, long long ms, bool liveEnd, Span* tmp) {
+    for (int i = d->spanCount - 1; i >= 0; i--) {
+        *tmp = d->spans[i];
+        if (liveEnd && i == d->spanCount - 1) tmp->toMs = LLONG_MAX;
+        if (tmp->fromMs <= ms && ms <= tmp->toMs) return tmp;
+    }
+    return nullptr;
+}
+
+int ReadTicks(int handle, const char* symbolName, bool live, long long startMs, long long endMs,
+              int maxTicks, T6* out, long long* uncoveredEndMs) {
+    if (uncoveredEndMs) *uncoveredEndMs = endMs;
+    if (handle < 0 || handle >= MAX_SYMBOLS || !symbolName || !*symbolName ||
+        !out || maxTicks <= 0 || endMs < startMs)
+        return 0;
+
+    // The recorder's open span of this symbol still runs unless a break came since
+    LONG64 open = InterlockedCompareExchange64(&s_open[handle], 0, 0);
+    int liveDay = -1;
+    if (live && s_running && open != 0 && (LONG)(open & 0xFFFFFFFF) == Gen(handle))
+        liveDay = (int)((open >> 32) - 1);
+
+    CsLock lock(G.csJournal);
+
+    // Walk the spans back from endMs while they join up
+    long long coveredFrom = endMs + 1;
+    for (long long cur = endMs; cur >= startMs;) {
+        int day = (int)(cur / DAY_MS);
+        Span tmp;
+        const Span* s = nullptr;
+        const Day* d = LoadDayLocked(handle, symbolName, day);
+        if (d) s = FindSpan(d, cur, day == liveDay, &tmp);
+        if (!s && liveDay >= 0 && liveDay < day) {
+            // Quiet since midnight: the open span is still in an older file
+            d = LoadDayLocked(handle, symbolName, liveDay);
+            if (d) s = FindSpan(d, cur, true, &tmp);
+        }
+        if (!s) break;
+        coveredFrom = s->fromMs;
+        cur = s->fromMs - 1;
+    }
+    if (coveredFrom > endMs) return 0;
+
+    long long fromMs = coveredFrom > startMs ? coveredFrom : startMs;
+    int count = 0;
+    for (int day = (int)(endMs / DAY_MS); day >= (int)(fromMs / DAY_MS) && count < maxTicks; day--) {
+        const Day* d = LoadDayLocked(handle, symbolName, day);
+        if (!d) continue;
+
+        // Newest first
+        for (size_t i = d->ticks.size(); i-- > 0 && count < maxTicks;) {
+            const JournalTick& t = d->ticks[i];
+            if (t.serverMs > endMs || t.serverMs < fromMs) continue;
+
+            float bid = (float)PriceToDouble(t.bid);
+            float spread = (float)PriceToDouble(t.ask - t.bid);
+            T6& o = out[count++];
+            o.time = Utils::UnixToOle(t.serverMs);
+            o.fHigh = o.fLow = o.fOpen = o.fClose = bid;
+            o.fVal = spread > 0.0f ? spread : 0.0f;
+            o.fVol = 1.0f;
+        }
+    }
+    if (uncoveredEndMs) *uncoveredEndMs = coveredFrom - 1;
+    return count;
+}
+
+void Reset() {
+    CsLock lock(G.csJournal);
+    for (Day* d : s_days) delete d;
+    s_days.clear();
+}
+
+} // namespace Journal
@@ -0,0 +1,181 @@
+#include "../include/state.h"
+#include "../include/rates.h"
+#include "../include/symbols.h"
+#include "../include/symtable.h"
+#include "../include/logger.h"
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Rates {
+
+// ============================================================
+// Graph - immutable after Build() except for the atomic rates
+// ============================================================
+
+struct Hop {
+    int handle;      // symbol used for this step
+    bool invert;     // we hold the symbol's quote asset: divide by bid
+};
+
+struct AssetNode {
+    long long assetId = 0;
+    int hops = -1;                   // -1 = not connected to the deposit asset
+    Hop path[MAX_HOPS];
+    std::atomic<double> rate{0.0};   // deposit units per 1 unit of this asset
+};
+
+struct Graph {
+    int numAssets = 0;
+    std::unique_ptr<AssetNode[]> assets;
+    std::vector<int> quoteAsset;               // handle -> asset index, -1 = none
+    std::vector<std::vector<int>> dependents;  // handle -> assets whose path uses it
+};
+
+// Readers pin the graph with a SymTable::Reader; a replaced graph is retired
+// through the symbol table's epoch reclamation
+static std::atomic<Graph*> s_graph{nullptr};
+
+static void FreeGraph(const void* p) { delete static_cast<const Graph*>(p); }
+
+static double Evaluate(const AssetNode& a, int quotedHandle, Price quotedBid) {
+    if (a.hops < 0) return 0.0;
+    double rate = 1.0;
+    for (int i = 0; i < a.hops; i++) {
+        const Hop& h = a.path[i];
+        Price bid = quotedBid;
+        if (h.handle != quotedHandle) {
+            Quote q;
+            bid = Symbols::GetQuote(h.handle, q) ? q.bid : 0;
+        }
+        if (bid <= 0) return 0.0;
+        rate = h.invert ? rate / PriceToDouble(bid) : rate * PriceToDouble(bid);
+    }
+    return rate;
+}
+
+void Build() {
+    struct Edge { int handle; long long base, quote; size_t nameLen; };
+    std::vector<Edge> edges;
+    long long deposit = G.depositAssetId;
+    int numHandles;
+    {
+        CsLock lock(G.csSymbols);
+        numHandles = (int)G.symbols.size();
+        for (const auto& sym : G.symbols) {
+            if (sym.baseAssetId > 0 && sym.quoteAssetId > 0 && sym.baseAssetId != sym.quoteAssetId)
+                edges.push_back({ sym.handle, sym.baseAssetId, sym.quoteAssetId, sym.name.size() });
+        }
+    }
+
+    Graph* g = new Graph();
+    g->quoteAsset.assign(numHandles, -1);
+    g->dependents.resize(numHandles);
+
+    // Dense asset index
+    std::map<long long, int> assetIndex;
+    for (const auto& e : edges) {
+        assetIndex.emplace(e.base, (int)assetIndex.size());
+        assetIndex.emplace(e.quote, (int)assetIndex.size());
+    }
+    g->numAssets = (int)assetIndex.size();
+    g->assets.reset(new AssetNode[g->numAssets > 0 ? g->numAssets : 1]);
+    for (const auto& kv : assetIndex) g->assets[kv.second].assetId = kv.first;
+    for (const auto& e : edges) g->quoteAsset[e.handle] = assetIndex[e.quote];
+
+    // One edge per asset pair: prefer the plain symbol name (EURUSD over EURUSD.x)
+    std::map<std::pair<int, int>, const Edge*> best;
+    for (const auto& e : edges) {
+        int a = assetIndex[e.base], b = assetIndex[e.quote];
+        auto key = std::make_pair(a < b ? a : b, a < b ? b : a);
+        auto it = best.find(key);
+        if (it == best.end() || e.nameLen < it->second->nameLen) best[key] = &e;
+    }
+    std::vector<std::vector<const Edge*>> adj(g->numAssets);
+    for (const auto& kv : best) {
+        adj[kv.first.first].push_back(kv.second);
+        adj[kv.first.second].push_back(kv.second);
+    }
+
+    // BFS from the deposit asset; path of a node = first hop + path of its parent
+    auto dep = assetIndex.find(deposit);
+    int connected = 0;
+    if (deposit > 0 && dep != assetIndex.end()) {
+        std::vector<int> queue;
+        g->assets[dep->second].hops = 0;
+        queue.push_back(dep->second);
+        for (size_t qi = 0; qi < queue.size(); qi++) {
+            const AssetNode& from = g->assets[queue[qi]];
+            if (from.hops >= MAX_HOPS) continue;
+            for (const Edge* e : adj[queue[qi]]) {
+                int next = assetIndex[e->base == from.assetId ? e->quote : e->base];
+                AssetNode& n = g->assets[next];
+                if (n.hops >= 0) continue;
+                n.path[0] = { e->handle, e->quote == n.assetId };
+                for (int i = 0; i < from.hops; i++) n.path[i + 1] = from.path[i];
+                n.hops = from.hops + 1;
+                queue.push_back(next);
+            }
+        }
+        for (int a = 0; a < g->numAssets; a++) {
+            AssetNode& n = g->assets[a];
+            if (n.hops < 0) continue;
+            connected++;
+            for (int i = 0; i < n.hops; i++) g->dependents[n.path[i].handle].push_back(a);
+            n.rate.store(n.hops == 0 ? 1.0 : Evaluate(n, -1, 0), std::memory_order_relaxed);
+        }
+    }
+
+    {
+        // Build may also run on the NetworkThread (symbol snapshot revalidation)
+        CsLock lock(G.csSymbols);
+        Graph* old = s_graph.exchange(g, std::memory_order_seq_cst);
+        SymTable::RetireLocked(&FreeGraph, old);
+    }
+
+    Log::Info("CONV", "Asset graph: %d assets, %d pairs, %d connected to deposit asset %lld",
+              g->numAssets, (int)best.size(), connected, deposit);
+}
+
+static const AssetNode* NodeOf(const Graph* g, int handle) {
+    if (!g || handle < 0 || handle >= (int)g->quoteAsset.size()) return nullptr;
+    int a = g->quoteAsset[handle];
+    return (a >= 0) ? &g->assets[a] : nullptr;
+}
+
+double QuoteToDeposit(int handle) {
+    SymTable::Reader pin;
+    const AssetNode* n = NodeOf(s_graph.load(std::memory_order_acquire), handle);
+    return n ? n->rate.load(std::memory_order_relaxed) : 0.0;
+}
+
+bool HasPath(int handle) {
+    SymTable::Reader pin;
+    const AssetNode* n = NodeOf(s_graph.load(std::memory_order_acquire), handle);
+    return n && n->hops >= 0;
+}
+
+void PathSymbols(int handle, std::vector<int>& out) {
+    SymTable::Reader pin;
+    const AssetNode* n = NodeOf(s_graph.load(std::memory_order_acquire), handle);
+    if (!n) return;
+    for (int i = 0; i < n->hops; i++) out.push_back(n->path[i].handle);
+}
+
+void OnQuote(int handle, Price bid) {
+    SymTable::Reader pin;
+    Graph* g = s_graph.load(std::memory_order_acquire);
+    if (!g || handle < 0 || handle >= (int)g->dependents.size()) return;
+    for (int a : g->dependents[handle]) {
+        AssetNode& n = g->assets[a];
+        double rate = Evaluate(n, handle, bid);
+        if (rate > 0.0) n.rate.store(rate, std::memory_order_relaxed);
+    }
+}
+
+void Reset() {
+    delete s_graph.exchange(nullptr);  // retired graphs go with SymTable::Reset()
+}
+
+} // namespace Rates
@@ -0,0 +1,233 @@
+#include "../include/state.h"
+#include "../include/spread.h"
+#include "../include/symbols.h"
+#include "../include/logger.h"
+#include "../include/utils.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <oleauto.h>  // VariantTimeToSystemTime
+
+namespace Spread {
+
+// ============================================================
+// File format (.spr)
+// Fixed 16-byte records, ascending by minute, appended by Flush().
+// One file per symbol per UTC year: History\{Symbol}_{year}.spr
+// ============================================================
+
+struct MinuteRecord {
+    int minute;      // Unix minutes (UTC)
+    int ticks;
+    float mean;      // spread in price units
+    float max;
+};
+static_assert(sizeof(MinuteRecord) == 16, "spread record layout");
+
+// Open minute per symbol handle (NetworkThread only)
+struct OpenMinute {
+    int minute;
+    int ticks;
+    long long sum;   // raw spread sum (PRICE_SCALE)
+    long long max;
+};
+
+struct Closed {
+    int handle;
+    MinuteRecord rec;
+};
+
+static OpenMinute s_open[MAX_SYMBOLS];
+static std::vector<Closed> s_closed;   // guarded by G.csSpread
+static volatile bool s_enabled = true;
+
+static void Close(int handle) {
+    OpenMinute& m = s_open[handle];
+    if (m.ticks <= 0) return;
+    Closed c;
+    c.handle = handle;
+    c.rec.minute = m.minute;
+    c.rec.ticks = m.ticks;
+    c.rec.mean = (float)((double)m.sum / m.ticks / PRICE_SCALE);
+    c.rec.max = (float)PriceToDouble(m.max);
+    memset(&m, 0, sizeof(m));
+
+    CsLock lock(G.csSpread);
+    s_closed.push_back(c);
+}
+
+void Record(int handle, long long serverMs, long long rawBid, long long rawAsk) {
+    if (!s_enabled || handle < 0 || handle >= MAX_SYMBOLS || serverMs <= 0) return;
+    if (rawBid <= 0 || rawAsk <= 0) return;
+
+    int minute = (int)(serverMs / 60000);
+    OpenMinute& m = s_open[handle];
+    if (m.ticks > 0 && minute != m.minute) {
+        if (minute < m.minute) return;  // out of order
+        Close(handle);
+    }
+    long long spread = rawAsk > rawBid ? rawAsk - rawBid : 0;
+    m.minute = minute;
+    m.ticks++;
+    m.sum += spread;
+    if (spread > m.max) m.max = spread;
+}
+
+void Roll() {
+    int nowMinute = (int)(Utils::NowUnixMs() / 60000);
+
+    // Allow one minute of server clock lead before closing a quiet minute
+    for (int h = 0; h < MAX_SYMBOLS; h++) {
+        if (s_open[h].ticks > 0 && s_open[h].minute < nowMinute - 1) Close(h);
+    }
+}
+
+// ============================================================
+// Files
+// ============================================================
+
+static int MinuteToYear(int minute) {
+    SYSTEMTIME st = {0};
+    VariantTimeToSystemTime(Utils::MinutesToOle(minute), &st);
+    return st.wYear;
+}
+
+// History\{Symbol}_{year}.spr, same name cleanup as the .t6 bar cache
+static void BuildPath(char* out, int maxLen, const char* symbolName, int year) {
+    char clean[64] = {0};
+    int j = 0;
+    for (const char* p = symbolName; *p && j < 62; p++) {
+        if (*p != '/' && *p != '\\' && *p != ' ') clean[j++] = *p;
+    }
+    sprintf_s(out, maxLen, "History\\%s_%d.spr", clean, year);
+}
+
+void Flush(bool closeOpen) {
+    if (closeOpen) {
+        for (int h = 0; h < MAX_SYMBOLS; h++) Close(h);
+    }
+
+    std::vector<Closed> closed;
+    {
+        CsLock lock(G.csSpread);
+        closed.swap(s_closed);
+    }
+    if (closed.empty()) return;
+
+    // Group by (handle, year); records of a handle are already in minute order
+    std::map<std::pair<int, int>, std::vector<MinuteRecord>> files;
+    for (const Closed& c : closed)
+        files[std::make_pair(c.handle, MinuteToYear(c.rec.minute))].push_back(c.rec);
+
+    CreateDirectoryA("History", NULL);
+    int written = 0;
+    for (auto& kv : files) {
+        std::string name;
+        {
+            CsLock lock(G.csSymbols);
+            if (kv.first.first < (int)G.symbols.size()) name = G.symbols[kv.first.first].name;
+        }
+        if (name.empty()) continue;
+
+        char path[MAX_PATH];
+        BuildPath(path, MAX_PATH, name.c_str(), kv.first.second);
+        FILE* f = nullptr;
+        fopen_s(&f, path, "ab");
+        if (!f) {
+            Log::Warn("SPREAD", "Cannot append %s", path);
+            continue;
+        }
+        written += (int)fwrite(kv.second.data(), sizeof(MinuteRecord), kv.second.size(), f);
+        fclose(f);
+    }
+    Log::Diag(1, "SPREAD Flushed %d minutes to %d files", written, (int)files.size());
+}
+
+// Records of [fromMinute, toMinute] from one year file, appended to out
+static void ReadYear(const char* symbolName, int year, int fromMinute, int toMinute,
+                     std::vector<MinuteRecord>& out) {
+    char path[MAX_PATH];
+    BuildPath(path, MAX_PATH, symbolName, year);
+    FILE* f = nullptr;
+    fopen_s(&f, path, "rb");
+    if (!f) return;
+
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f) / (long)sizeof(MinuteRecord);
+
+    // Binary search for the first record >= fromMinute
+    long lo = 0, hi = n;
+    MinuteRecord r;
+    while (lo < hi) {
+        long mid = (lo + hi) / 2;
+        fseek(f, mid * (long)sizeof(MinuteRecord), SEEK_SET);
+        if (fread(&r, sizeof(r), 1, f) != 1) break;
+        if (r.minute < fromMinute) lo = mid + 1;
+        else hi = mid;
+    }
+
+    fseek(f, lo * (long)sizeof(MinuteRecord), SEEK_SET);
+    while (fread(&r, sizeof(r), 1, f) == 1 && r.minute <= toMinute) {
+        if (r.ticks > 0) out.push_back(r);
+    }
+    fclose(f);
+}
+
+int Apply(const char* symbolName, int nTickMinutes, T6* bars, int count) {
+    if (!symbolName || !bars || count <= 0 || nTickMinutes <= 0) return 0;
+    Flush();
+
+    // Files are named after the cTrader symbol, as written by Flush()
+    SymbolInfo sym;
+    if (!Symbols::GetSymbol(symbolName, sym)) return 0;
+
+    // Bar times are open times; the newest bar spans nTickMinutes from there
+    int fromMinute = (int)((Utils::OleToUnix(bars[count - 1].time) + 30000) / 60000);
+    int toMinute = (int)((Utils::OleToUnix(bars[0].time) + 30000) / 60000) + nTickMinutes - 1;
+    if (toMinute < fromMinute) return 0;
+
+    std::vector<MinuteRecord> recs;
+    for (int y = MinuteToYear(fromMinute); y <= MinuteToYear(toMinute); y++)
+        ReadYear(sym.name.c_str(), y, fromMinute, toMinute, recs);
+    if (recs.empty()) return 0;
+
+    // Oldest bar first, one pass over the records
+    int stamped = 0;
+    size_t r = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        int open = (int)((Utils::OleToUnix(bars[i].time) + 30000) / 60000);
+        int close = (i > 0) ? (int)((Utils::OleToUnix(bars[i - 1].time) + 30000) / 60000) : open + nTickMinutes;
+        if (close > open + nTickMinutes) close = open + nTickMinutes;  // gap after this bar
+
+        while (r < recs.size() && recs[r].minute < open) r++;
+        long long ticks = 0;
+        double sum = 0.0;
+        for (size_t k = r; k < recs.size() && recs[k].minute < close; k++) {
+            ticks += recs[k].ticks;
+            sum += (double)recs[k].mean * recs[k].ticks;
+        }
+        if (ticks <= 0) continue;
+
+        bars[i].fVal = (float)(sum / (double)ticks);
+        if (bars[i].fVol <= 0.0f) bars[i].fVol = (float)ticks;
+        stamped++;
+    }
+    return stamped;
+}
+
+void Enable(bool on) {
+    s_enabled = on;
+}
+
+bool IsEnabled() {
+    return s_enabled;
+}
+
+void Reset() {
+    memset(s_open, 0, sizeof(s_open));
+    CsLock lock(G.csSpread);
+    s_closed.clear();
+}
+
+} // namespace Spread
@@ -1,5 +1,18 @@
 #include "../include/state.h"
 #include "../include/logger.h"
+#include "../include/stats.h"
+#include "../include/symbols.h"
+#include "../include/book.h"
+#include "../include/bars.h"
+#include "../include/feed.h"
+#include "../include/rates.h"
+#include "../include/health.h"
+#include "../include/subs.h"
+#include "../include/tickring.h"
+#include "../include/journal.h"
+#include "../include/spread.h"
+#include "../include/indicators.h"
+#include "../include/symtable.h"
 
 int(__cdecl* BrokerMessage)(const char* Text) = nullptr;
 int(__cdecl* BrokerProgress)(intptr_t Progress) = nullptr;
@@ -15,6 +28,13 @@ void Init() {
     InitializeCriticalSection(&G.csHistory);
     InitializeCriticalSection(&G.csWebSocket);
     InitializeCriticalSection(&G.csTrading);
+    InitializeCriticalSection(&G.csBars);
+    InitializeCriticalSection(&G.csSubs);
+    InitializeCriticalSection(&G.csSpread);
+    InitializeCriticalSection(&G.csIndicators);
+    InitializeCriticalSection(&G.csHistStore);
+    InitializeCriticalSection(&G.csJournal);
+    InitializeCriticalSection(&G.csStats);
     G.historyResponseBuf = (char*)malloc(State::HIST_BUF_SIZE);
     if (G.historyResponseBuf) G.historyResponseBuf[0] = '\0';
     G.tradingResponseBuf = (char*)malloc(State::TRADE_BUF_SIZE);
@@ -30,15 +50,32 @@ void Destroy() {
     DeleteCriticalSection(&G.csHistory);
     DeleteCriticalSection(&G.csWebSocket);
     DeleteCriticalSection(&G.csTrading);
+    DeleteCriticalSection(&G.csBars);
+    DeleteCriticalSection(&G.csSubs);
+    DeleteCriticalSection(&G.csSpread);
+    DeleteCriticalSection(&G.csIndicators);
+    DeleteCriticalSection(&G.csHistStore);
+    DeleteCriticalSection(&G.csJournal);
+    DeleteCriticalSection(&G.csStats);
 }
 
 void Reset() {
-    // Symbols
+    // Symbols + order books
     {
         CsLock lock(G.csSymbols);
-        G.symbols.clear();
-        G.symbolIdToName.clear();
+        Symbols::ClearSymbols();
+        Book::Reset();
     }
+    // Live bar rings, feed counters
+    Bars::Reset();
+    Feed::Reset();
+    Health::Reset();
+    Subs::Reset();
+    TickRing::Reset();
+    Journal::Reset();
+    Spread::Reset();
+    Indicators::Reset();
+    SymTable::Reset();
     // Trades
     {
         CsLock lock(G.csTrades);
@@ -96,9 +133,18 @@ void Reset() {
     G.waitingForMargin = false;
     G.marginResponseReady = false;
     G.marginPendingSymbolId = 0;
+    {
+        CsLock lock(G.csSymbols);
+        G.marginPendingMsgId.clear();
+        G.marginPendingByMsgId.clear();
+        G.conversionPending.clear();
+        G.detailQueue.clear();
+        G.detailPendingByMsgId.clear();
+    }
 
-    // Conversion cache (M9)
+    // Conversion cache (M9) and asset graph
     G.quoteToDepositConv.clear();
+    Rates::Reset();
     G.waitingForConversion = false;
     G.conversionResponseReady = false;
 
@@ -118,6 +164,9 @@ void Reset() {
     // Env lock reset for new login (NOT reconnect)
     G.envLocked = false;
 
+    // Traffic counters
+    Stats::Reset();
+
     Log::Info("STATE", "Session state reset");
 }
 
@@ -132,12 +181,20 @@ void ResetConnection() {
     }
 
     // Reset subscription flags (need to resubscribe after reconnect)
+    // and drop on-demand detail requests lost with the connection
     {
         CsLock lock(G.csSymbols);
-        for (auto& kv : G.symbols) {
-            kv.second.subscribed = false;
+        for (auto& sym : G.symbols) {
+            sym.subscribed = false;
+            sym.detailsPending = false;
+            sym.detailsDirty = false;
         }
+        SymTable::PublishAllLocked();
+        G.detailQueue.clear();
+        G.detailPendingByMsgId.clear();
     }
+    TickRing::BreakAll();  // ticks missed while disconnected
+    Journal::BreakAll();
 
     // Timing
     G.lastHeartbeatMs = 0;
@@ -0,0 +1,246 @@
+#include "../include/state.h"
+#include "../include/stats.h"
+#include "../include/logger.h"
+#include "../include/zorro_constants.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace Stats {
+
+// Slot layout: 0 = unknown payloadType, 1 = HeartbeatEvent (51),
+// 2..101 = Open API messages 2100..2199
+static constexpr int NUM_SLOTS = 102;
+static constexpr int FIRST_API_PT = 2100;
+
+struct Counters {
+    volatile LONG64 msgsIn = 0;
+    volatile LONG64 bytesIn = 0;
+    volatile LONG64 msgsOut = 0;
+    volatile LONG64 bytesOut = 0;
+    volatile LONG64 dispatchCount = 0;
+    volatile LONG64 dispatchTicks = 0;
+    volatile LONG64 maxDispatchTicks = 0;  // per window, cleared by Roll()
+    volatile LONG64 maxMsgBytes = 0;       // per window, cleared by Roll()
+};
+
+// Plain (non-volatile) copy of one slot for window arithmetic
+struct Totals {
+    long long msgsIn = 0, bytesIn = 0, msgsOut = 0, bytesOut = 0;
+    long long dispatchCount = 0, dispatchTicks = 0;
+    long long maxDispatchTicks = 0, maxMsgBytes = 0;
+};
+
+static Counters s_cur[NUM_SLOTS];        // cumulative since Reset()
+
+// Window state, rewritten by Roll() while the Zorro thread may read a snapshot: csStats
+static Totals s_prev[NUM_SLOTS];         // cumulative at last Roll()
+static Totals s_window[NUM_SLOTS];       // deltas of last completed window
+static ULONGLONG s_prevRollMs = 0;
+static ULONGLONG s_windowMs = 0;         // length of last completed window (0 = none yet)
+static long long s_qpcFreq = 0;
+
+static int SlotOf(int payloadType) {
+    if (payloadType == 51) return 1;
+    if (payloadType >= FIRST_API_PT && payloadType < FIRST_API_PT + NUM_SLOTS - 2)
+        return payloadType - FIRST_API_PT + 2;
+    return 0;
+}
+
+static int PayloadTypeOf(int slot) {
+    if (slot == 1) return 51;
+    if (slot >= 2) return FIRST_API_PT + slot - 2;
+    return 0;
+}
+
+// Lock-free running maximum
+static void UpdateMax(volatile LONG64* target, long long value) {
+    long long cur = *target;
+    while (value > cur) {
+        long long prev = InterlockedCompareExchange64(target, value, cur);
+        if (prev == cur) break;
+        cur = prev;
+    }
+}
+
+long long Ticks() {
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+}
+
+double TicksToUs(long long ticks) {
+    if (s_qpcFreq == 0) {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        s_qpcFreq = f.QuadPart > 0 ? f.QuadPart : 1;
+    }
+    return (double)ticks * 1000000.0 / (double)s_qpcFreq;
+}
+
+void RecordSend(int payloadType, int bytes) {
+    Counters& c = s_cur[SlotOf(payloadType)];
+    InterlockedIncrement64(&c.msgsOut);
+    InterlockedExchangeAdd64(&c.bytesOut, bytes);
+    UpdateMax(&c.maxMsgBytes, bytes);
+}
+
+void RecordReceive(int payloadType, int bytes) {
+    Counters& c = s_cur[SlotOf(payloadType)];
+    InterlockedIncrement64(&c.msgsIn);
+    InterlockedExchangeAdd64(&c.bytesIn, bytes);
+    UpdateMax(&c.maxMsgBytes, bytes);
+}
+
+void RecordDispatch(int payloadType, long long recvTicks) {
+    long long dt = Ticks() - recvTicks;
+    if (dt < 0) dt = 0;
+    Counters& c = s_cur[SlotOf(payloadType)];
+    InterlockedIncrement64(&c.dispatchCount);
+    InterlockedExchangeAdd64(&c.dispatchTicks, dt);
+    UpdateMax(&c.maxDispatchTicks, dt);
+}
+
+static Totals Capture(int slot) {
+    Counters& c = s_cur[slot];
+    Totals t;
+    t.msgsIn = c.msgsIn;
+    t.bytesIn = c.bytesIn;
+    t.msgsOut = c.msgsOut;
+    t.bytesOut = c.bytesOut;
+    t.dispatchCount = c.dispatchCount;
+    t.dispatchTicks = c.dispatchTicks;
+    t.maxDispatchTicks = c.maxDispatchTicks;
+    t.maxMsgBytes = c.maxMsgBytes;
+    return t;
+}
+
+static Totals Delta(const Totals& now, const Totals& before) {
+    Totals d;
+    d.msgsIn = now.msgsIn - before.msgsIn;
+    d.bytesIn = now.bytesIn - before.bytesIn;
+    d.msgsOut = now.msgsOut - before.msgsOut;
+    d.bytesOut = now.bytesOut - before.bytesOut;
+    d.dispatchCount = now.dispatchCount - before.dispatchCount;
+    d.dispatchTicks = now.dispatchTicks - before.dispatchTicks;
+    d.maxDispatchTicks = now.maxDispatchTicks;
+    d.maxMsgBytes = now.maxMsgBytes;
+    return d;
+}
+
+void Roll() {
+    CsLock lock(G.csStats);
+    ULONGLONG now = GetTickCount64();
+    if (s_prevRollMs == 0) s_prevRollMs = now;
+
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        Totals t = Capture(i);
+        s_window[i] = Delta(t, s_prev[i]);
+        s_prev[i] = t;
+        // Maxima are per window: restart them
+        InterlockedExchange64(&s_cur[i].maxDispatchTicks, 0);
+        InterlockedExchange64(&s_cur[i].maxMsgBytes, 0);
+    }
+    s_windowMs = now - s_prevRollMs;
+    s_prevRollMs = now;
+}
+
+// Sum (or select) a window over the requested payloadType. Caller holds csStats.
+static Totals Select(int payloadType, bool live, ULONGLONG* windowMs) {
+    Totals sum;
+    ULONGLONG now = GetTickCount64();
+    *windowMs = live ? (now - s_prevRollMs) : s_windowMs;
+
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        if (payloadType != 0 && i != SlotOf(payloadType)) continue;
+        Totals w = live ? Delta(Capture(i), s_prev[i]) : s_window[i];
+        sum.msgsIn += w.msgsIn;
+        sum.bytesIn += w.bytesIn;
+        sum.msgsOut += w.msgsOut;
+        sum.bytesOut += w.bytesOut;
+        sum.dispatchCount += w.dispatchCount;
+        sum.dispatchTicks += w.dispatchTicks;
+        sum.maxDispatchTicks = (std::max)(sum.maxDispatchTicks, w.maxDispatchTicks);
+        sum.maxMsgBytes = (std::max)(sum.maxMsgBytes, w.maxMsgBytes);
+    }
+    return sum;
+}
+
+bool GetSnapshot(TrafficStats* out) {
+    if (!out) return false;
+
+    ULONGLONG windowMs = 0;
+    Totals t;
+    {
+        CsLock lock(G.csStats);
+        if (s_prevRollMs == 0) s_prevRollMs = GetTickCount64();
+        t = Select(out->payloadType, s_windowMs == 0, &windowMs);
+    }
+    double sec = (windowMs > 0) ? (double)windowMs / 1000.0 : 1.0;
+
+    out->windowSec = (int)(sec + 0.5);
+    out->msgsIn = (double)t.msgsIn;
+    out->msgsOut = (double)t.msgsOut;
+    out->bytesIn = (double)t.bytesIn;
+    out->bytesOut = (double)t.bytesOut;
+    out->msgsInPerSec = (double)t.msgsIn / sec;
+    out->msgsOutPerSec = (double)t.msgsOut / sec;
+    out->bytesInPerSec = (double)t.bytesIn / sec;
+    out->bytesOutPerSec = (double)t.bytesOut / sec;
+    out->maxMsgBytes = (double)t.maxMsgBytes;
+    out->avgDispatchUs = (t.dispatchCount > 0)
+        ? TicksToUs(t.dispatchTicks) / (double)t.dispatchCount : 0.0;
+    out->maxDispatchUs = TicksToUs(t.maxDispatchTicks);
+    return true;
+}
+
+void LogSnapshot() {
+    CsLock lock(G.csStats);
+    if (s_windowMs == 0) return;
+
+    ULONGLONG windowMs = 0;
+    Totals all = Select(0, false, &windowMs);
+    double sec = (double)windowMs / 1000.0;
+    if (sec <= 0.0) return;
+
+    Log::Info("STATS", "Traffic %.0fs: in=%lld msgs (%.1f/s, %.1f KB/s) out=%lld msgs (%.1f/s) maxMsg=%lld B dispatch avg=%.0fus max=%.0fus",
+              sec, all.msgsIn, (double)all.msgsIn / sec, (double)all.bytesIn / 1024.0 / sec,
+              all.msgsOut, (double)all.msgsOut / sec, all.maxMsgBytes,
+              all.dispatchCount > 0 ? TicksToUs(all.dispatchTicks) / (double)all.dispatchCount : 0.0,
+              TicksToUs(all.maxDispatchTicks));
+
+    // Busiest payload types by inbound+outbound bytes (top 5)
+    int order[NUM_SLOTS];
+    for (int i = 0; i < NUM_SLOTS; i++) order[i] = i;
+    std::sort(order, order + NUM_SLOTS, [](int a, int b) {
+        return s_window[a].bytesIn + s_window[a].bytesOut > s_window[b].bytesIn + s_window[b].bytesOut;
+    });
+    for (int k = 0; k < 5; k++) {
+        const Totals& w = s_window[order[k]];
+        if (w.msgsIn + w.msgsOut == 0) break;
+        Log::Info("STATS", "  pt=%d: in=%lld (%lld B) out=%lld (%lld B) maxMsg=%lld B dispatch avg=%.0fus",
+                  PayloadTypeOf(order[k]), w.msgsIn, w.bytesIn, w.msgsOut, w.bytesOut, w.maxMsgBytes,
+                  w.dispatchCount > 0 ? TicksToUs(w.dispatchTicks) / (double)w.dispatchCount : 0.0);
+    }
+}
+
+void Reset() {
+    CsLock lock(G.csStats);
+    for (int i = 0; i < NUM_SLOTS; i++) {
+        Counters& c = s_cur[i];
+        InterlockedExchange64(&c.msgsIn, 0);
+        InterlockedExchange64(&c.bytesIn, 0);
+        InterlockedExchange64(&c.msgsOut, 0);
+        InterlockedExchange64(&c.bytesOut, 0);
+        InterlockedExchange64(&c.dispatchCount, 0);
+        InterlockedExchange64(&c.dispatchTicks, 0);
+        InterlockedExchange64(&c.maxDispatchTicks, 0);
+        InterlockedExchange64(&c.maxMsgBytes, 0);
+        s_prev[i] = Totals();
+        s_window[i] = Totals();
+    }
+    s_prevRollMs = GetTickCount64();
+    s_windowMs = 0;
+}
+
+} // namespace Stats
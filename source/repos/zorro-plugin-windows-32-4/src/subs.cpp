@@ -0,0 +1,217 @@
+#include "../include/state.h"
+#include "../include/subs.h"
+#include "../include/symbols.h"
+#include "../include/rates.h"
+#include "../include/bars.h"
+#include "../include/indicators.h"
+#include "../include/tickring.h"
+#include "../include/logger.h"
+#include <cstring>
+
+namespace Subs {
+
+// ============================================================
+// Leases per symbol handle: last use in GetTickCount64() ms, 0 = never.
+// Guarded by G.csSymbols (same lock as SymbolInfo::subscribed).
+// ============================================================
+
+static ULONGLONG s_lease[MAX_SYMBOLS][2];  // [handle][SUB_ASSET / SUB_CONVERSION]
+static volatile LONG s_idleMs = DEFAULT_IDLE_SEC * 1000;
+
+// Counted holders at the time of the call, indexed by handle
+struct Holders {
+    std::vector<int> refs[SUB_CONSUMERS];
+};
+
+// Server conversion chain of an asset without a local path (main thread map).
+// Caller holds csSymbols.
+static void ServerLegsLocked(int handle, std::vector<int>& legs) {
+    if (handle < 0 || handle >= (int)G.symbols.size()) return;
+    auto it = G.quoteToDepositConv.find(G.symbols[handle].quoteAssetId);
+    if (it == G.quoteToDepositConv.end()) return;
+    for (const auto& e : it->second.chain) legs.push_back(Symbols::GetHandleById(e.symbolId));
+}
+
+static void CountHolders(Holders& h, int numHandles) {
+    for (int c = SUB_POSITION; c < SUB_CONSUMERS; c++) h.refs[c].assign(numHandles, 0);
+
+    std::vector<std::string> open;
+    {
+        CsLock lock(G.csTrades);
+        for (const auto& kv : G.trades) {
+            if (kv.second.open && kv.second.positionId > 0) open.push_back(kv.second.symbol);
+        }
+    }
+    // A position also holds the legs that convert its PnL to the deposit currency
+    std::vector<int> positions, held;
+    for (const auto& name : open) {
+        int handle = Symbols::GetHandle(name.c_str());
+        if (handle < 0 || handle >= numHandles) continue;
+        positions.push_back(handle);
+        held.push_back(handle);
+        Rates::PathSymbols(handle, held);
+    }
+    if (!positions.empty()) {
+        CsLock lock(G.csSymbols);
+        for (int handle : positions) ServerLegsLocked(handle, held);
+    }
+    for (int handle : held) {
+        if (handle >= 0 && handle < numHandles) h.refs[SUB_POSITION][handle]++;
+    }
+    Bars::CountLive(h.refs[SUB_BARS]);
+    Indicators::CountStreams(h.refs[SUB_INDICATORS]);
+}
+
+// Held by a counted consumer (positions, bar streams)
+static bool Held(int handle, const Holders& h) {
+    for (int c = SUB_POSITION; c < SUB_CONSUMERS; c++) {
+        if (handle < (int)h.refs[c].size() && h.refs[c][handle] > 0) return true;
+    }
+    return false;
+}
+
+static bool Wanted(int handle, const Holders& h, ULONGLONG now, LONG idleMs) {
+    if (Held(handle, h)) return true;
+    const ULONGLONG* lease = s_lease[handle];
+    return now - lease[SUB_ASSET] < (ULONGLONG)idleMs || now - lease[SUB_CONVERSION] < (ULONGLONG)idleMs;
+}
+
+// ============================================================
+// Zorro thread
+// ============================================================
+
+int UseMany(const std::vector<std::string>& names) {
+    std::vector<int> assets;
+    for (const auto& name : names) {
+        int handle = Symbols::GetHandle(name.c_str());
+        if (handle >= 0 && handle < MAX_SYMBOLS) assets.push_back(handle);
+    }
+    return UseHandles(assets);
+}
+
+int UseHandles(const std::vector<int>& handles) {
+    std::vector<int> assets, legs;
+    for (int handle : handles) {
+        if (handle < 0 || handle >= MAX_SYMBOLS) continue;
+        assets.push_back(handle);
+        Rates::PathSymbols(handle, legs);
+    }
+    if (assets.empty()) return 0;
+
+    CsLock order(G.csSubs);
+    std::vector<std::string> toSubscribe;
+    int subscribedNow = 0;
+    {
+        CsLock lock(G.csSymbols);
+        ULONGLONG now = GetTickCount64();
+
+        for (int h : assets) ServerLegsLocked(h, legs);
+
+        for (int h : assets) {
+            if (h >= (int)G.symbols.size()) continue;
+            s_lease[h][SUB_ASSET] = now;
+            if (!G.symbols[h].subscribed) {
+                toSubscribe.push_back(G.symbols[h].name);
+                subscribedNow++;
+            }
+        }
+        for (int h : legs) {
+            if (h < 0 || h >= (int)G.symbols.size()) continue;
+            s_lease[h][SUB_CONVERSION] = now;
+            if (!G.symbols[h].subscribed) toSubscribe.push_back(G.symbols[h].name);
+        }
+    }
+    if (!toSubscribe.empty()) Symbols::SubscribeMany(toSubscribe);
+    return subscribedNow;
+}
+
+bool Use(const char* name) {
+    if (!name || !*name) return false;
+    return UseMany(std::vector<std::string>(1, name)) > 0;
+}
+
+void SetIdleTimeout(int seconds) {
+    InterlockedExchange(&s_idleMs, seconds > 0 ? seconds * 1000 : 0);
+}
+
+// ============================================================
+// NetworkThread
+// ============================================================
+
+void Sweep() {
+    LONG idleMs = s_idleMs;
+    int numHandles;
+    {
+        CsLock lock(G.csSymbols);
+        numHandles = (int)G.symbols.size();
+    }
+    Holders holders;
+    CountHolders(holders, numHandles);
+
+    CsLock order(G.csSubs);
+    std::vector<int> idle;
+    int subscribed = 0, byPosition = 0, byBars = 0;
+    {
+        CsLock lock(G.csSymbols);
+        ULONGLONG now = GetTickCount64();
+        for (const auto& sym : G.symbols) {
+            int h = sym.handle;
+            if (h < 0 || h >= numHandles) continue;
+            if (!sym.subscribed) {
+                TickRing::ReleaseLocked(h);  // a SpotEvent that crossed the unsubscribe
+                continue;
+            }
+
+            // Subscribed outside Use() (live bars, server chains): lease starts now
+            if (s_lease[h][SUB_ASSET] == 0 && s_lease[h][SUB_CONVERSION] == 0) s_lease[h][SUB_ASSET] = now;
+
+            if (holders.refs[SUB_POSITION][h] > 0) byPosition++;
+            if (holders.refs[SUB_BARS][h] > 0) byBars++;
+            if (idleMs <= 0 || Wanted(h, holders, now, idleMs)) {
+                subscribed++;
+                continue;
+            }
+            idle.push_back(h);
+        }
+    }
+    if (idle.empty()) return;
+
+    int n = Symbols::UnsubscribeMany(idle);
+    Log::Info("SUBS", "Unsubscribed %d idle symbols (idle %lds); %d still subscribed, %d held by positions, %d by live bars",
+              n, (long)(idleMs / 1000), subscribed, byPosition, byBars);
+}
+
+void Resubscribe() {
+    LONG idleMs = s_idleMs;
+    int numHandles;
+    {
+        CsLock lock(G.csSymbols);
+        numHandles = (int)G.symbols.size();
+    }
+    Holders holders;
+    CountHolders(holders, numHandles);
+
+    CsLock order(G.csSubs);
+    std::vector<std::string> names;
+    {
+        CsLock lock(G.csSymbols);
+        ULONGLONG now = GetTickCount64();
+        for (const auto& sym : G.symbols) {
+            int h = sym.handle;
+            if (h < 0 || h >= numHandles || sym.subscribed) continue;
+            bool leased = s_lease[h][SUB_ASSET] != 0 || s_lease[h][SUB_CONVERSION] != 0;
+            if (!leased && !Held(h, holders)) continue;
+            if (idleMs > 0 && !Wanted(h, holders, now, idleMs)) continue;
+            names.push_back(sym.name);
+        }
+    }
+    int n = Symbols::SubscribeMany(names);
+    if (n > 0) Log::Info("SUBS", "Resubscribed %d symbols in one request", n);
+}
+
+void Reset() {
+    CsLock lock(G.csSymbols);
+    memset(s_lease, 0, sizeof(s_lease));
+}
+
+} // namespace Subs
@@ -2,17 +2,116 @@
 #include "../include/symbols.h"
 #include "../include/protocol.h"
 #include "../include/websocket.h"
+#include "../include/stats.h"
 #include "../include/logger.h"
 #include "../include/utils.h"
+#include "../include/journal.h"
+#include "../include/bars.h"
+#include "../include/feed.h"
+#include "../include/rates.h"
+#include "../include/health.h"
+#include "../include/tickring.h"
+#include "../include/spread.h"
+#include "../include/indicators.h"
+#include "../include/symtable.h"
+#include "../include/subs.h"
 #include <cstdio>
 #include <cstring>
+#include <cmath>
+#include <unordered_set>
 #include <vector>
 
 namespace Symbols {
 
 // Forward declarations
 static std::string NormalizeSymbol(const char* name);
-static std::string FindSymbolName(const char* name);
+static SymbolInfo* FindSymbolLocked(const char* name);
+static void ReleaseDetailRequestLocked(const State::DetailRequest& req);
+static bool RequeueIfDirtyLocked(SymbolInfo& sym);
+void FlushDetailQueue();
+static SymbolInfo* SymbolByHandleLocked(int handle);
+static void RebuildAliases(const std::vector<int>& touched);
+
+// Last full quote per handle as received (NetworkThread only)
+struct LastSpot {
+    long long bid, ask, ts;
+};
+static LastSpot s_lastSpot[MAX_SYMBOLS];
+
+// Conversion path already subscribed by GetQuoteToDepositRate (main thread)
+static bool s_pathSubscribed[MAX_SYMBOLS];
+
+// ============================================================
+// symbolId -> handle index (insert-only open addressing)
+// Writers hold csSymbols; HandleSpotEvent reads without any lock.
+// ============================================================
+
+static unsigned IdIndexSlot(long long symbolId) {
+    unsigned long long h = (unsigned long long)symbolId * 0x9E3779B97F4A7C15ull;
+    return (unsigned)(h >> 32) & (State::SYMBOL_ID_INDEX_SIZE - 1);
+}
+
+// Caller holds csSymbols
+static void IndexSymbolId(long long symbolId, int handle) {
+    unsigned i = IdIndexSlot(symbolId);
+    for (int n = 0; n < State::SYMBOL_ID_INDEX_SIZE; n++) {
+        SymbolIdSlot& e = G.symbolIdIndex[i];
+        long long key = e.symbolId.load(std::memory_order_relaxed);
+        if (key == symbolId) {
+            e.handle.store(handle, std::memory_order_release);
+            return;
+        }
+        if (key == 0) {
+            // Publish handle before key: a reader that sees the key sees the handle
+            e.handle.store(handle, std::memory_order_relaxed);
+            e.symbolId.store(symbolId, std::memory_order_release);
+            return;
+        }
+        i = (i + 1) & (State::SYMBOL_ID_INDEX_SIZE - 1);
+    }
+}
+
+int GetHandleById(long long symbolId) {
+    if (symbolId <= 0) return -1;
+    unsigned i = IdIndexSlot(symbolId);
+    for (int n = 0; n < State::SYMBOL_ID_INDEX_SIZE; n++) {
+        const SymbolIdSlot& e = G.symbolIdIndex[i];
+        long long key = e.symbolId.load(std::memory_order_acquire);
+        if (key == symbolId) return e.handle.load(std::memory_order_relaxed);
+        if (key == 0) return -1;
+        i = (i + 1) & (State::SYMBOL_ID_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+unsigned QuoteSeq(int handle) {
+    if (handle < 0 || handle >= MAX_SYMBOLS) return 0;
+    return G.quotes[handle].seq.load(std::memory_order_acquire);
+}
+
+bool GetQuote(int handle, Quote& out) {
+    if (handle < 0 || handle >= MAX_SYMBOLS) return false;
+    G.quotes[handle].Load(out);
+    return true;
+}
+
+void ClearSymbols() {
+    CsLock lock(G.csSymbols);
+    for (size_t i = 0; i < G.symbols.size(); i++) G.quotes[i].Clear();
+    memset(s_lastSpot, 0, sizeof(s_lastSpot));
+    memset(s_pathSubscribed, 0, sizeof(s_pathSubscribed));
+    for (int i = 0; i < State::SYMBOL_ID_INDEX_SIZE; i++) {
+        G.symbolIdIndex[i].symbolId.store(0, std::memory_order_relaxed);
+        G.symbolIdIndex[i].handle.store(-1, std::memory_order_relaxed);
+    }
+    G.symbols.clear();
+    G.symbolHandles.clear();
+    G.symbolAliases.clear();
+    G.detailQueue.clear();
+    G.detailPendingByMsgId.clear();
+    SymTable::PublishAllLocked();  // before the generation: cached handles see the new table
+    InterlockedIncrement(&G.symbolGeneration);
+}
 
 bool RequestSymbolList() {
     const int MAX_RETRIES = 3;
@@ -23,7 +122,7 @@ bool RequestSymbolList() {
 
         const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
                                                  PayloadType::SymbolsListReq, payload);
-        if (!WebSocket::Send(msg)) {
+        if (!WebSocket::Send(msg, ToInt(PayloadType::SymbolsListReq))) {
             Log::Error("SYM", "SymbolsListReq send failed (attempt %d/%d)", attempt, MAX_RETRIES);
             if (attempt < MAX_RETRIES) { Sleep(1000); continue; }
             return false;
@@ -36,6 +135,7 @@ bool RequestSymbolList() {
             int n = WebSocket::Receive(response, sizeof(response));
             if (n > 0) {
                 int pt = Protocol::ExtractPayloadType(response);
+                Stats::RecordReceive(pt, n);
                 if (pt == ToInt(PayloadType::SymbolsListRes)) {
                     HandleSymbolsListRes(response);
                     return true;
@@ -59,13 +159,19 @@ bool RequestSymbolList() {
     return false;
 }
 
-void HandleSymbolsListRes(const char* buffer) {
-    CsLock lock(G.csSymbols);
-
+int HandleSymbolsListRes(const char* buffer, bool prune) {
+    // Parse without csSymbols; readers keep the published table meanwhile
+    struct Listed {
+        long long symbolId;
+        std::string name;
+        long long baseAssetId, quoteAssetId;
+    };
     const char* arr = Protocol::ExtractArray(buffer, "symbol");
     int count = Protocol::CountArrayElements(arr);
 
     Log::Info("SYM", "Received %d symbols", count);
+    std::vector<Listed> listed;
+    listed.reserve(count);
 
     for (int i = 0; i < count; i++) {
         const char* elem = Protocol::GetArrayElement(arr, i);
@@ -76,17 +182,111 @@ void HandleSymbolsListRes(const char* buffer) {
         bool enabled = Protocol::ExtractBool(elem, "enabled");
 
         if (symbolId > 0 && name && *name && enabled) {
-            SymbolInfo& sym = G.symbols[name];
-            sym.symbolId = symbolId;
-            sym.name = name;
-            sym.baseAssetId = Protocol::ExtractInt64(elem, "baseAssetId");
-            sym.quoteAssetId = Protocol::ExtractInt64(elem, "quoteAssetId");
+            listed.push_back({ symbolId, name, Protocol::ExtractInt64(elem, "baseAssetId"),
+                               Protocol::ExtractInt64(elem, "quoteAssetId") });
+        }
+    }
 
-            G.symbolIdToName[symbolId] = name;
+    CsLock lock(G.csSymbols);
+    int added = 0;
+    std::vector<int> touched, fresh;
+    for (const Listed& l : listed) {
+        auto hit = G.symbolHandles.find(l.name);
+        int handle;
+        if (hit != G.symbolHandles.end()) {
+            handle = hit->second;
+        } else {
+            if ((int)G.symbols.size() >= MAX_SYMBOLS) {
+                Log::Warn("SYM", "Symbol table full (%d), skipping %s", MAX_SYMBOLS, l.name.c_str());
+                continue;
+            }
+            handle = (int)G.symbols.size();
+            G.symbols.emplace_back();
+            G.symbols[handle].handle = handle;
+            G.symbolHandles[l.name] = handle;
+            fresh.push_back(handle);
+            added++;
+        }
+
+        SymbolInfo& sym = G.symbols[handle];
+        if (sym.symbolId == l.symbolId && sym.baseAssetId == l.baseAssetId &&
+            sym.quoteAssetId == l.quoteAssetId) continue;  // unchanged, nothing to publish
+        sym.symbolId = l.symbolId;
+        sym.name = l.name;
+        sym.baseAssetId = l.baseAssetId;
+        sym.quoteAssetId = l.quoteAssetId;
+        touched.push_back(handle);
+
+        IndexSymbolId(l.symbolId, handle);
+    }
+
+    // Symbols a snapshot restored that the server no longer lists
+    int pruned = 0;
+    if (prune) {
+        std::unordered_set<std::string> current;
+        for (const Listed& l : listed) current.insert(l.name);
+        for (SymbolInfo& sym : G.symbols) {
+            if (sym.symbolId <= 0 || current.count(sym.name)) continue;
+            Log::Diag(1, "SYM %s no longer listed, dropped", sym.name.c_str());
+            G.symbolHandles.erase(sym.name);
+            IndexSymbolId(sym.symbolId, -1);  // spot events for the old id are ignored
+            sym.symbolId = 0;
+            sym.baseAssetId = 0;
+            sym.quoteAssetId = 0;
+            sym.detailsLoaded = false;
+            sym.detailsPending = false;
+            sym.detailsDirty = false;
+            touched.push_back(sym.handle);
+            pruned++;
         }
     }
 
-    Log::Info("SYM", "Stored %d enabled symbols", (int)G.symbols.size());
+    // Listed after login (SymbolChangedEvent): without lazy details nobody else
+    // loads their contract, so queue it for the caller's FlushDetailQueue().
+    // A revalidation requests all symbols itself.
+    if (!G.lazyDetails && !prune && G.running) {
+        for (int h : fresh) {
+            G.symbols[h].detailsPending = true;
+            G.detailQueue.push_back(G.symbols[h].symbolId);
+        }
+    }
+
+    RebuildAliases(touched);
+    Log::Info("SYM", "Stored %d enabled symbols (%d aliases)",
+              (int)G.symbols.size(), (int)G.symbolAliases.size());
+    if (pruned > 0) Log::Info("SYM", "Dropped %d symbols no longer listed", pruned);
+    return added;
+}
+
+void RestoreSymbols(const std::vector<SymbolInfo>& cached) {
+    CsLock lock(G.csSymbols);
+    std::vector<int> touched;
+    touched.reserve(cached.size());
+    for (const auto& c : cached) {
+        if (c.symbolId <= 0 || c.name.empty()) continue;
+        auto hit = G.symbolHandles.find(c.name);
+        int handle;
+        if (hit != G.symbolHandles.end()) {
+            handle = hit->second;
+        } else {
+            if ((int)G.symbols.size() >= MAX_SYMBOLS) {
+                Log::Warn("SYM", "Symbol table full (%d), skipping %s", MAX_SYMBOLS, c.name.c_str());
+                continue;
+            }
+            handle = (int)G.symbols.size();
+            G.symbols.emplace_back();
+            G.symbolHandles[c.name] = handle;
+        }
+
+        SymbolInfo& sym = G.symbols[handle];
+        bool subscribed = sym.subscribed;
+        sym = c;
+        sym.handle = handle;
+        sym.subscribed = subscribed;
+        IndexSymbolId(c.symbolId, handle);
+        touched.push_back(handle);
+    }
+    RebuildAliases(touched);
 }
 
 bool RequestSymbolDetails() {
@@ -95,8 +295,8 @@ bool RequestSymbolDetails() {
     {
         CsLock lock(G.csSymbols);
         if (G.symbols.empty()) return false;
-        for (auto& kv : G.symbols) {
-            ids.push_back(kv.second.symbolId);
+        for (auto& sym : G.symbols) {
+            ids.push_back(sym.symbolId);
         }
     }  // lock released here, exactly once
 
@@ -119,7 +319,7 @@ bool RequestSymbolDetails() {
 
         const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
                                                  PayloadType::SymbolByIdReq, payload);
-        if (!WebSocket::Send(msg)) return false;
+        if (!WebSocket::Send(msg, ToInt(PayloadType::SymbolByIdReq))) return false;
 
         // Wait for response
         char response[131072] = {0};
@@ -128,6 +328,7 @@ bool RequestSymbolDetails() {
             int n = WebSocket::Receive(response, sizeof(response));
             if (n > 0) {
                 int pt = Protocol::ExtractPayloadType(response);
+                Stats::RecordReceive(pt, n);
                 if (pt == ToInt(PayloadType::SymbolByIdRes)) {
                     HandleSymbolByIdRes(response);
                     break;
@@ -144,139 +345,461 @@ bool RequestSymbolDetails() {
     return true;
 }
 
-void HandleSymbolByIdRes(const char* buffer) {
-    CsLock lock(G.csSymbols);
+bool HandleSymbolByIdRes(const char* buffer) {
+    std::string msgId = Protocol::ExtractString(buffer, "clientMsgId");
 
+    // Parse without csSymbols into contract-only records
     const char* arr = Protocol::ExtractArray(buffer, "symbol");
     int count = Protocol::CountArrayElements(arr);
+    std::vector<SymbolInfo> parsed;
+    parsed.reserve(count);
 
     for (int i = 0; i < count; i++) {
         const char* elem = Protocol::GetArrayElement(arr, i);
         if (!elem || !*elem) continue;
 
-        long long symbolId = Protocol::ExtractInt64(elem, "symbolId");
-
-        // Find by ID in reverse map
-        auto it = G.symbolIdToName.find(symbolId);
-        if (it == G.symbolIdToName.end()) continue;
-
-        auto sit = G.symbols.find(it->second);
-        if (sit == G.symbols.end()) continue;
-
-        SymbolInfo& sym = sit->second;
-        sym.digits = Protocol::ExtractInt(elem, "digits");
-        sym.pipPosition = Protocol::ExtractInt(elem, "pipPosition");
-        sym.lotSize = Protocol::ExtractInt64(elem, "lotSize");
-        sym.minVolume = Protocol::ExtractInt64(elem, "minVolume");
-        sym.maxVolume = Protocol::ExtractInt64(elem, "maxVolume");
-        sym.stepVolume = Protocol::ExtractInt64(elem, "stepVolume");
-        sym.swapLong = Protocol::ExtractDouble(elem, "swapLong");
-        sym.swapShort = Protocol::ExtractDouble(elem, "swapShort");
-        sym.swapCalculationType = Protocol::ExtractInt(elem, "swapCalculationType");
-        sym.commissionRaw = Protocol::ExtractInt64(elem, "commission");
-        sym.commissionType = Protocol::ExtractInt(elem, "commissionType");
+        parsed.emplace_back();
+        SymbolInfo& d = parsed.back();
+        d.symbolId = Protocol::ExtractInt64(elem, "symbolId");
+        d.digits = Protocol::ExtractInt(elem, "digits");
+        d.pipPosition = Protocol::ExtractInt(elem, "pipPosition");
+        d.lotSize = Protocol::ExtractInt64(elem, "lotSize");
+        d.minVolume = Protocol::ExtractInt64(elem, "minVolume");
+        d.maxVolume = Protocol::ExtractInt64(elem, "maxVolume");
+        d.stepVolume = Protocol::ExtractInt64(elem, "stepVolume");
+        d.swapLong = Protocol::ExtractDouble(elem, "swapLong");
+        d.swapShort = Protocol::ExtractDouble(elem, "swapShort");
+        d.swapCalculationType = Protocol::ExtractInt(elem, "swapCalculationType");
+        d.commissionRaw = Protocol::ExtractInt64(elem, "commission");
+        d.commissionType = Protocol::ExtractInt(elem, "commissionType");
 
         // Default lotSize if not set
-        if (sym.lotSize <= 0) sym.lotSize = 100000;
-        if (sym.minVolume <= 0) sym.minVolume = 1000;
-        if (sym.stepVolume <= 0) sym.stepVolume = 1000;
+        if (d.lotSize <= 0) d.lotSize = 100000;
+        if (d.minVolume <= 0) d.minVolume = 1000;
+        if (d.stepVolume <= 0) d.stepVolume = 1000;
+    }
+
+    CsLock lock(G.csSymbols);
+    std::vector<int> changed;
+    changed.reserve(parsed.size());
+
+    for (const SymbolInfo& d : parsed) {
+        SymbolInfo* found = SymbolByHandleLocked(GetHandleById(d.symbolId));
+        if (!found) continue;
+
+        SymbolInfo sym = *found;
+        sym.digits = d.digits;
+        sym.pipPosition = d.pipPosition;
+        sym.lotSize = d.lotSize;
+        sym.minVolume = d.minVolume;
+        sym.maxVolume = d.maxVolume;
+        sym.stepVolume = d.stepVolume;
+        sym.swapLong = d.swapLong;
+        sym.swapShort = d.swapShort;
+        sym.swapCalculationType = d.swapCalculationType;
+        sym.commissionRaw = d.commissionRaw;
+        sym.commissionType = d.commissionType;
+        sym.detailsLoaded = true;
+        sym.detailsPending = false;
+
+        // Contract change (SymbolChangedEvent, revalidation): margin per lot is
+        // measured for ComputeLotAmount(minVolume, lotSize), so drop it if those moved
+        const SymbolInfo& old = *found;
+        if (old.detailsLoaded) {
+            if (sym.lotSize != old.lotSize || sym.minVolume != old.minVolume) sym.marginPerLot = 0.0;
+            if (sym.digits != old.digits || sym.lotSize != old.lotSize ||
+                sym.minVolume != old.minVolume || sym.maxVolume != old.maxVolume ||
+                sym.stepVolume != old.stepVolume || sym.swapLong != old.swapLong ||
+                sym.swapShort != old.swapShort || sym.commissionRaw != old.commissionRaw ||
+                sym.commissionType != old.commissionType || sym.swapCalculationType != old.swapCalculationType) {
+                Log::Info("SYM", "%s contract changed: swap %.4f/%.4f commission %lld volume %lld-%lld step %lld",
+                          sym.name.c_str(), sym.swapLong, sym.swapShort, sym.commissionRaw,
+                          sym.minVolume, sym.maxVolume, sym.stepVolume);
+            }
+        }
+        *found = sym;
+        changed.push_back(sym.handle);
+    }
 
+    // On-demand request: release symbols the server did not return
+    auto it = G.detailPendingByMsgId.find(msgId);
+    bool onDemand = it != G.detailPendingByMsgId.end();
+    if (onDemand) {
+        ReleaseDetailRequestLocked(it->second);
+        G.detailPendingByMsgId.erase(it);
+    }
+    // This reply may predate a SymbolChangedEvent
+    for (int h : changed) RequeueIfDirtyLocked(*SymbolByHandleLocked(h));
+    SymTable::PublishLocked(changed);
+
+    if (onDemand) {
+        Log::Diag(1, "SYM details on demand: %d symbols received", count);
+        return false;
     }
 
     Log::Info("SYM", "Updated details for %d symbols", count);
+    return true;
 }
 
-bool Subscribe(const char* symbolName) {
-    if (!symbolName || !*symbolName) return false;
+// ============================================================
+// Contract details on first use (SET_LAZYDETAILS)
+// First uses queue their symbols. While a request is outstanding, new first
+// uses collect in the queue and go out together with the next one.
+// ============================================================
 
-    long long symbolId = 0;
+static constexpr ULONGLONG DETAIL_TIMEOUT_MS = 5000;
+
+// A SymbolChangedEvent arrived while its request was in flight: ask again
+// (once, the flag is cleared here). Caller holds csSymbols.
+static bool RequeueIfDirtyLocked(SymbolInfo& sym) {
+    if (!sym.detailsDirty) return false;
+    sym.detailsDirty = false;
+    sym.detailsPending = true;
+    G.detailQueue.push_back(sym.symbolId);
+    return true;
+}
+
+static void ReleaseDetailRequestLocked(const State::DetailRequest& req) {
+    std::vector<int> released;
+    for (long long id : req.symbolIds) {
+        SymbolInfo* sym = SymbolByHandleLocked(GetHandleById(id));
+        if (!sym || !sym->detailsPending) continue;
+        sym->detailsPending = false;
+        RequeueIfDirtyLocked(*sym);
+        released.push_back(sym->handle);
+    }
+    SymTable::PublishLocked(released);
+}
+
+void FlushDetailQueue() {
+    std::vector<std::string> msgIds;
+    std::vector<std::string> payloads;
     {
         CsLock lock(G.csSymbols);
-        std::string actual = FindSymbolName(symbolName);
-        if (actual.empty()) {
-            Log::Warn("SYM", "Symbol not found: %s", symbolName);
-            return false;
+        ULONGLONG now = GetTickCount64();
+        for (auto it = G.detailPendingByMsgId.begin(); it != G.detailPendingByMsgId.end();) {
+            if (now - it->second.sentMs < DETAIL_TIMEOUT_MS) { ++it; continue; }
+            ReleaseDetailRequestLocked(it->second);
+            it = G.detailPendingByMsgId.erase(it);
         }
+        if (G.detailQueue.empty() || !G.detailPendingByMsgId.empty()) return;
+
+        const size_t BATCH = 50;
+        for (size_t offset = 0; offset < G.detailQueue.size(); offset += BATCH) {
+            size_t end = (offset + BATCH < G.detailQueue.size()) ? offset + BATCH : G.detailQueue.size();
+            State::DetailRequest req;
+            req.symbolIds.assign(G.detailQueue.begin() + offset, G.detailQueue.begin() + end);
+            req.sentMs = now;
+
+            std::string payload = "\"ctidTraderAccountId\":" + std::to_string(G.accountId) + ",\"symbolId\":[";
+            for (size_t j = 0; j < req.symbolIds.size(); j++) {
+                if (j > 0) payload += ",";
+                payload += std::to_string(req.symbolIds[j]);
+            }
+            payload += "]";
 
-        auto& sym = G.symbols[actual];
-        if (sym.subscribed) return true;  // Already subscribed
-        symbolId = sym.symbolId;
-        sym.subscribed = true;  // Mark optimistically
+            std::string msgId = Utils::NextMsgId();
+            G.detailPendingByMsgId[msgId] = std::move(req);
+            msgIds.push_back(msgId);
+            payloads.push_back(payload);
+        }
+        Log::Diag(1, "SYM details on demand: %d symbols in %d request(s)",
+                  (int)G.detailQueue.size(), (int)msgIds.size());
+        G.detailQueue.clear();
     }
 
-    char payload[256];
-    sprintf_s(payload, "\"ctidTraderAccountId\":%lld,\"symbolId\":[%lld]",
-              G.accountId, symbolId);
+    for (size_t i = 0; i < msgIds.size(); i++) {
+        const char* msg = Protocol::BuildMessage(msgIds[i].c_str(), PayloadType::SymbolByIdReq, payloads[i].c_str());
+        if (!WebSocket::Send(msg, ToInt(PayloadType::SymbolByIdReq))) {
+            CsLock lock(G.csSymbols);
+            auto it = G.detailPendingByMsgId.find(msgIds[i]);
+            if (it != G.detailPendingByMsgId.end()) {
+                ReleaseDetailRequestLocked(it->second);
+                G.detailPendingByMsgId.erase(it);
+            }
+        }
+    }
+}
 
-    const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
-                                             PayloadType::SubscribeSpotsReq, payload);
-    if (!WebSocket::Send(msg)) return false;
+bool EnsureDetails(const std::vector<std::string>& names) {
+    std::vector<int> handles, queued;
+    {
+        CsLock lock(G.csSymbols);
+        for (const auto& name : names) {
+            SymbolInfo* sym = FindSymbolLocked(name.c_str());
+            if (!sym || sym->detailsLoaded) continue;
+            handles.push_back(sym->handle);
+            if (!sym->detailsPending && G.running) {
+                sym->detailsPending = true;
+                G.detailQueue.push_back(sym->symbolId);
+                queued.push_back(sym->handle);
+            }
+        }
+        SymTable::PublishLocked(queued);
+    }
+    if (handles.empty()) return true;
+    if (!G.running) return false;  // responses arrive on the NetworkThread only
 
-    Log::Diag(1, "SYM Subscribe sent for %s (id=%lld)", symbolName, symbolId);
+    ULONGLONG start = GetTickCount64();
+    while (true) {
+        FlushDetailQueue();
+        int missing = 0;
+        bool pending = false;
+        {
+            CsLock lock(G.csSymbols);
+            for (int h : handles) {
+                const SymbolInfo* sym = SymbolByHandleLocked(h);
+                if (!sym || sym->detailsLoaded) continue;
+                missing++;
+                if (sym->detailsPending) pending = true;
+            }
+        }
+        if (!pending) {
+            if (missing > 0) Log::Warn("SYM", "Details on demand: %d symbol(s) not returned", missing);
+            return missing == 0;
+        }
+        if (GetTickCount64() - start >= DETAIL_TIMEOUT_MS) {
+            Log::Warn("SYM", "Details on demand: timeout for %d symbol(s)", missing);
+            return false;
+        }
+        Sleep(10);
+    }
+}
 
-    // Don't wait for response - NetworkThread will handle SubscribeSpotsRes
-    // Give server a moment to start sending quotes
-    Sleep(200);
-    return true;
+bool EnsureDetails(const char* name) {
+    if (!name || !*name) return false;
+    return EnsureDetails(std::vector<std::string>(1, name));
 }
 
-void BatchResubscribe() {
-    std::vector<std::pair<std::string, long long>> toSub;
+void HandleSymbolChangedEvent(const char* buffer) {
+    const char* arr = Protocol::ExtractArray(buffer, "symbolId");
+    int count = Protocol::CountArrayElements(arr);
+    int queued = 0, unknown = 0;
     {
         CsLock lock(G.csSymbols);
-        for (auto& kv : G.symbols) {
-            if (kv.second.subscribed) {
-                toSub.push_back({kv.first, kv.second.symbolId});
-                kv.second.subscribed = false;
+        std::vector<int> touched;
+        for (int i = 0; i < count; i++) {
+            const char* elem = Protocol::GetArrayElement(arr, i);
+            if (*elem == '"') elem++;
+            long long symbolId = _atoi64(elem);
+            SymbolInfo* sym = SymbolByHandleLocked(GetHandleById(symbolId));
+            if (!sym) {
+                if (symbolId > 0) unknown++;
+                continue;
             }
+            // Margin rules may have changed with the contract; BrokerAsset reloads it
+            sym->marginPerLot = 0.0;
+            touched.push_back(sym->handle);
+            // A request in flight may answer with the old contract: repeat it on arrival
+            if (sym->detailsPending) {
+                sym->detailsDirty = true;
+                queued++;
+                continue;
+            }
+            // Without details yet, first use loads the new contract anyway
+            if (!sym->detailsLoaded) continue;
+            sym->detailsPending = true;
+            G.detailQueue.push_back(symbolId);
+            queued++;
+        }
+        SymTable::PublishLocked(touched);
+    }
+    Log::Info("SYM", "SymbolChangedEvent: %d symbols, %d refreshed, %d new", count, queued, unknown);
+
+    if (queued > 0) FlushDetailQueue();
+
+    // New symbols: light list only, merged by HandleSymbolsListRes
+    if (unknown > 0) {
+        char payload[128];
+        sprintf_s(payload, "\"ctidTraderAccountId\":%lld", G.accountId);
+        const char* msg = Protocol::BuildMessage(Utils::NextMsgId(), PayloadType::SymbolsListReq, payload);
+        WebSocket::Send(msg, ToInt(PayloadType::SymbolsListReq));
+    }
+}
+
+int DetailsLoadedCount() {
+    CsLock lock(G.csSymbols);
+    int n = 0;
+    for (const auto& sym : G.symbols) {
+        if (sym.detailsLoaded) n++;
+    }
+    return n;
+}
+
+bool Subscribe(const char* symbolName) {
+    if (!symbolName || !*symbolName) return false;
+
+    long long symbolId = 0;
+    {
+        CsLock order(G.csSubs);  // request order against Subs::Sweep unsubscribes
+        {
+            CsLock lock(G.csSymbols);
+            SymbolInfo* found = FindSymbolLocked(symbolName);
+            if (!found) {
+                Log::Warn("SYM", "Symbol not found: %s", symbolName);
+                return false;
+            }
+
+            auto& sym = *found;
+            if (sym.subscribed) return true;  // Already subscribed
+            symbolId = sym.symbolId;
+            sym.subscribed = true;  // Mark optimistically
+            SymTable::PublishLocked(sym.handle);
         }
-    }  // lock released here, exactly once
 
-    for (auto& s : toSub) {
         char payload[256];
         sprintf_s(payload, "\"ctidTraderAccountId\":%lld,\"symbolId\":[%lld]",
-                  G.accountId, s.second);
+                  G.accountId, symbolId);
 
         const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
                                                  PayloadType::SubscribeSpotsReq, payload);
-        WebSocket::Send(msg);
-        Sleep(50);  // Small delay between subscriptions
+        if (!WebSocket::Send(msg, ToInt(PayloadType::SubscribeSpotsReq))) return false;
     }
+
+    Log::Diag(1, "SYM Subscribe sent for %s (id=%lld)", symbolName, symbolId);
+
+    // Don't wait for response - NetworkThread will handle SubscribeSpotsRes
+    // Give server a moment to start sending quotes
+    Sleep(200);
+    return true;
 }
 
-void HandleSpotEvent(const char* buffer) {
-    long long symbolId = Protocol::ExtractInt64(buffer, "symbolId");
-    if (symbolId <= 0) return;
+int SubscribeMany(const std::vector<std::string>& names) {
+    CsLock order(G.csSubs);  // request order against Subs::Sweep unsubscribes
+    std::string ids;
+    int count = 0;
+    {
+        CsLock lock(G.csSymbols);
+        std::vector<int> marked;
+        for (const auto& name : names) {
+            SymbolInfo* sym = FindSymbolLocked(name.c_str());
+            if (!sym || sym->subscribed) continue;
+            sym->subscribed = true;  // Mark optimistically
+            marked.push_back(sym->handle);
+            char id[32];
+            sprintf_s(id, "%s%lld", count ? "," : "", sym->symbolId);
+            ids += id;
+            count++;
+        }
+        SymTable::PublishLocked(marked);
+    }
+    if (count == 0) return 0;
 
-    CsLock lock(G.csSymbols);
+    std::string payload = "\"ctidTraderAccountId\":" + std::to_string(G.accountId) +
+                          ",\"symbolId\":[" + ids + "]";
+    const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
+                                             PayloadType::SubscribeSpotsReq, payload.c_str());
+    if (!WebSocket::Send(msg, ToInt(PayloadType::SubscribeSpotsReq))) return 0;
+
+    Log::Diag(1, "SYM Subscribe sent for %d symbols in one request", count);
+    return count;
+}
+
+int UnsubscribeMany(const std::vector<int>& handles) {
+    CsLock order(G.csSubs);
+    std::string ids;
+    int count = 0;
+    {
+        CsLock lock(G.csSymbols);
+        std::vector<int> cleared;
+        for (int h : handles) {
+            SymbolInfo* sym = SymbolByHandleLocked(h);
+            if (!sym || !sym->subscribed) continue;
+            sym->subscribed = false;
+            cleared.push_back(h);
+            TickRing::ReleaseLocked(h);  // no more ticks: the ring would only go stale
+            Journal::Break(h);
+            char id[32];
+            sprintf_s(id, "%s%lld", count ? "," : "", sym->symbolId);
+            ids += id;
+            count++;
+        }
+        SymTable::PublishLocked(cleared);
+    }
+    if (count == 0) return 0;
 
-    auto it = G.symbolIdToName.find(symbolId);
-    if (it == G.symbolIdToName.end()) return;
+    std::string payload = "\"ctidTraderAccountId\":" + std::to_string(G.accountId) +
+                          ",\"symbolId\":[" + ids + "]";
+    const char* msg = Protocol::BuildMessage(Utils::NextMsgId(),
+                                             PayloadType::UnsubscribeSpotsReq, payload.c_str());
+    if (!WebSocket::Send(msg, ToInt(PayloadType::UnsubscribeSpotsReq))) return 0;
 
-    auto sit = G.symbols.find(it->second);
-    if (sit == G.symbols.end()) return;
+    Log::Diag(1, "SYM Unsubscribe sent for %d symbols in one request", count);
+    return count;
+}
 
-    SymbolInfo& sym = sit->second;
+// Hot path (NetworkThread): no csSymbols, no map lookups.
+// Completes the quote, journals it and applies it through Feed::Post.
+void HandleSpotEvent(const char* buffer, long long recvTicks) {
+    long long symbolId = Protocol::ExtractInt64(buffer, "symbolId");
+    int handle = GetHandleById(symbolId);
+    if (handle < 0) return;
 
-    // Prices come as raw integers, divide by PRICE_SCALE
+    // Prices come as raw integers (PRICE_SCALE)
+    // A SpotEvent may carry only one side: keep the other from the last SpotEvent
     long long rawBid = Protocol::ExtractInt64(buffer, "bid");
     long long rawAsk = Protocol::ExtractInt64(buffer, "ask");
-
-    if (rawBid > 0) sym.bid = (double)rawBid / PRICE_SCALE;
-    if (rawAsk > 0) sym.ask = (double)rawAsk / PRICE_SCALE;
-
-    // Timestamp
     long long ts = Protocol::ExtractInt64(buffer, "timestamp");
+    Health::RecordQuote(handle, ts, recvTicks);
+
+    LastSpot& s = s_lastSpot[handle];
+    if (rawBid > 0) s.bid = rawBid;
+    if (rawAsk > 0) s.ask = rawAsk;
     if (ts > 0) {
-        sym.lastQuoteTime = ts;
+        s.ts = ts;
         G.lastServerTimestamp = ts;
     }
 
-    sym.subscribed = true;
+    if (s.bid > 0 && s.ask > 0) {
+        Journal::Record(handle, symbolId, s.ts, s.bid, s.ask);
+        if (ts > 0) {
+            TickRing::Push(handle, ts, s.bid, s.ask);
+            Spread::Record(handle, ts, s.bid, s.ask);
+        }
+    }
+
+    // Live trendbars ride on the SpotEvent
+    if (Bars::AnyLive())
+        Bars::HandleSpotTrendbars(symbolId, buffer, PriceToDouble(s.bid), PriceToDouble(s.ask));
+
+    Feed::Post(handle, s.bid, s.ask, s.ts);
+
     G.quoteCount++;
     G.lastQuoteRecvMs = GetTickCount64();
 }
 
+// Feed::Post on the NetworkThread: the only writer of G.quotes. One cache line written.
+void ApplyQuote(int handle, long long rawBid, long long rawAsk, long long ts) {
+    if (handle < 0 || handle >= MAX_SYMBOLS) return;
+    QuoteSlot& q = G.quotes[handle];
+
+    long long prevTs = q.lastQuoteTime.load(std::memory_order_relaxed);
+    Price bid = (rawBid > 0) ? rawBid : q.bid.load(std::memory_order_relaxed);
+    Price ask = (rawAsk > 0) ? rawAsk : q.ask.load(std::memory_order_relaxed);
+    if (ts <= 0) ts = prevTs;
+
+    // Daily bid range, restarted on the first quote of a new UTC day
+    Price high = q.high.load(std::memory_order_relaxed);
+    Price low = q.low.load(std::memory_order_relaxed);
+    if (bid > 0) {
+        if (prevTs / 86400000 != ts / 86400000 || high <= 0) {
+            high = bid;
+            low = bid;
+        } else {
+            if (bid > high) high = bid;
+            if (bid < low) low = bid;
+        }
+    }
+
+    q.Store(bid, ask, high, low, ts);
+
+    // Push the new bid into the conversion rates and indicator bars of this symbol
+    if (bid > 0) {
+        Rates::OnQuote(handle, bid);
+        Indicators::OnQuote(handle, PriceToDouble(bid), ts);
+    }
+}
+
 // Normalize symbol name: strip slashes, dots, spaces, convert to uppercase
 // e.g. "EUR/USD" -> "EURUSD", "EUR/USD." -> "EURUSD"
 static std::string NormalizeSymbol(const char* name) {
@@ -289,42 +812,126 @@ static std::string NormalizeSymbol(const char* name) {
     return result;
 }
 
-// Find the actual cTrader symbol name from a Zorro name
-// Zorro may send "EUR/USD" but cTrader stores "EURUSD" (or vice versa)
-static std::string FindSymbolName(const char* name) {
-    // First try exact match
-    if (G.symbols.count(name)) return name;
+// Map every exact and normalized name to its handle, so lookups by Zorro name
+// ("EUR/USD") or cTrader name ("EURUSD") are one hash probe.
+// Exact names win over normalized aliases; among aliases the first name in
+// sorted order wins (same result as the former linear scan). Publishes the
+// new names with the touched records. Caller holds csSymbols.
+static void RebuildAliases(const std::vector<int>& touched) {
+    std::map<std::string, int> sorted(G.symbolHandles.begin(), G.symbolHandles.end());
+    G.symbolAliases.clear();
+    G.symbolAliases.reserve(sorted.size() * 2);
+    for (auto& kv : sorted) {
+        G.symbolAliases.emplace(NormalizeSymbol(kv.first.c_str()), kv.second);
+    }
+    for (auto& kv : sorted) {
+        G.symbolAliases[kv.first] = kv.second;
+    }
+    SymTable::PublishLocked(touched, true);
+    InterlockedIncrement(&G.symbolGeneration);
+}
+
+// Name lookup in a published table (no csSymbols)
+static int FindHandle(const SymTable::Table& t, const char* name) {
+    auto it = t.names->find(name);
+    if (it == t.names->end()) it = t.names->find(NormalizeSymbol(name));
+    return (it != t.names->end()) ? it->second : -1;
+}
 
-    // Normalize input and try matching against all known symbols
-    std::string normalized = NormalizeSymbol(name);
-    for (auto& kv : G.symbols) {
-        std::string symNorm = NormalizeSymbol(kv.first.c_str());
-        if (symNorm == normalized) return kv.first;
+// Caller holds csSymbols
+static SymbolInfo* SymbolByHandleLocked(int handle) {
+    if (handle < 0 || handle >= (int)G.symbols.size()) return nullptr;
+    return &G.symbols[handle];
+}
+
+// ============================================================
+// Asset string -> handle cache
+// Zorro calls BrokerAsset/BrokerBuy2/GET_* with the same few asset strings
+// over and over. A small direct-mapped per-thread cache resolves them
+// without normalizing; misses probe the published table (SymTable), so
+// neither path takes csSymbols. Entries are tagged with G.symbolGeneration,
+// so reloading the symbol list invalidates them.
+// ============================================================
+
+struct AssetCacheEntry {
+    char name[48];
+    int handle;
+    LONG generation;
+};
+
+static constexpr int ASSET_CACHE_SIZE = 32;  // power of two
+__declspec(thread) static AssetCacheEntry s_assetCache[ASSET_CACHE_SIZE];
+
+static unsigned AssetHash(const char* name) {
+    unsigned h = 2166136261u;  // FNV-1a
+    for (const char* p = name; *p; p++) h = (h ^ (unsigned char)*p) * 16777619u;
+    return h;
+}
+
+int GetHandle(const char* name) {
+    if (!name || !*name) return -1;
+
+    LONG gen = G.symbolGeneration;
+    AssetCacheEntry& e = s_assetCache[AssetHash(name) & (ASSET_CACHE_SIZE - 1)];
+    if (e.generation == gen && e.handle >= 0 && strcmp(e.name, name) == 0)
+        return e.handle;
+
+    int handle;
+    {
+        SymTable::Reader table;
+        handle = FindHandle(*table, name);
+    }
+
+    // Misses are not cached: the symbol may appear with the next list
+    if (handle >= 0 && strlen(name) < sizeof(e.name)) {
+        strcpy_s(e.name, name);
+        e.handle = handle;
+        e.generation = gen;
     }
+    return handle;
+}
 
-    return "";  // Not found
+// Find a symbol by Zorro or cTrader name. Caller holds csSymbols.
+static SymbolInfo* FindSymbolLocked(const char* name) {
+    return SymbolByHandleLocked(GetHandle(name));
 }
 
-void HandleExpectedMarginRes(const char* buffer) {
+bool HandleExpectedMarginRes(const char* buffer) {
     // ExpectedMarginRes does NOT contain symbolId (only ctidTraderAccountId + margin[])
-    // We use G.marginPendingSymbolId set by BrokerAsset before sending the request
-    long long symbolId = G.marginPendingSymbolId;
+    // Pipelined requests are matched by clientMsgId, BrokerAsset's by the
+    // G.marginPendingMsgId/SymbolId it set before sending the request
+    long long symbolId = 0;
+    bool pipelined = false;
+    {
+        std::string msgId = Protocol::ExtractString(buffer, "clientMsgId");
+        CsLock lock(G.csSymbols);
+        auto it = G.marginPendingByMsgId.find(msgId);
+        if (it != G.marginPendingByMsgId.end()) {
+            symbolId = it->second;
+            pipelined = true;
+            G.marginPendingByMsgId.erase(it);
+        } else if (msgId != G.marginPendingMsgId) {
+            Log::Diag(1, "SYM ExpectedMarginRes %s: request no longer pending, ignored", msgId.c_str());
+            return false;
+        }
+    }
+    if (!pipelined) symbolId = G.marginPendingSymbolId;
     if (symbolId <= 0) {
         Log::Warn("SYM", "ExpectedMarginRes: no pending symbolId");
-        return;
+        return !pipelined;
     }
 
     // Parse margin array: [{ "volume": X, "buyMargin": Y, "sellMargin": Z }]
     const char* arr = Protocol::ExtractArray(buffer, "margin");
     if (!arr || *arr == '\0') {
         Log::Warn("SYM", "ExpectedMarginRes: missing margin array for symbolId=%lld", symbolId);
-        return;
+        return !pipelined;
     }
 
     const char* elem = Protocol::GetArrayElement(arr, 0);
     if (!elem || !*elem) {
         Log::Warn("SYM", "ExpectedMarginRes: empty margin element for symbolId=%lld", symbolId);
-        return;
+        return !pipelined;
     }
 
     long long rawBuy = Protocol::ExtractInt64(elem, "buyMargin");
@@ -340,38 +947,101 @@ void HandleExpectedMarginRes(const char* buffer) {
 
     {
         CsLock lock(G.csSymbols);
-        auto it = G.symbolIdToName.find(symbolId);
-        if (it != G.symbolIdToName.end()) {
-            auto sit = G.symbols.find(it->second);
-            if (sit != G.symbols.end()) {
-                sit->second.marginPerLot = margin;
-                Log::Diag(1, "SYM MARGIN %s: buy=%.4f sell=%.4f -> marginPerLot=%.4f",
-                          it->second.c_str(), buyMargin, sellMargin, margin);
-            }
+        SymbolInfo* sym = SymbolByHandleLocked(GetHandleById(symbolId));
+        if (sym) {
+            sym->marginPerLot = margin;
+            SymTable::PublishLocked(sym->handle);
+            Log::Diag(1, "SYM MARGIN %s: buy=%.4f sell=%.4f -> marginPerLot=%.4f",
+                      sym->name.c_str(), buyMargin, sellMargin, margin);
         } else {
             Log::Warn("SYM", "ExpectedMarginRes: symbolId=%lld not found in map", symbolId);
         }
     }
+    return !pipelined;
+}
+
+std::string RequestMarginAsync(long long symbolId, long long volume) {
+    std::string msgId = Utils::NextMsgId();
+    char payload[256];
+    sprintf_s(payload, "\"ctidTraderAccountId\":%lld,\"symbolId\":%lld,\"volume\":[%lld]",
+              G.accountId, symbolId, volume);
+    {
+        CsLock lock(G.csSymbols);
+        G.marginPendingByMsgId[msgId] = symbolId;
+    }
+
+    const char* msg = Protocol::BuildMessage(msgId.c_str(), PayloadType::ExpectedMarginReq, payload);
+    if (!WebSocket::Send(msg, ToInt(PayloadType::ExpectedMarginReq))) {
+        CsLock lock(G.csSymbols);
+        G.marginPendingByMsgId.erase(msgId);
+        return "";
+    }
+    return msgId;
+}
+
+void CancelMarginRequests(const std::vector<std::string>& msgIds) {
+    CsLock lock(G.csSymbols);
+    for (const auto& id : msgIds) G.marginPendingByMsgId.erase(id);
+}
+
+bool IsRequestPending(const std::string& msgId) {
+    CsLock lock(G.csSymbols);
+    if (G.marginPendingByMsgId.count(msgId)) return true;
+    if (G.detailPendingByMsgId.count(msgId)) return true;
+    auto it = G.conversionPending.find(msgId);
+    return it != G.conversionPending.end() && !it->second.done;
+}
+
+void HandleRequestError(const char* buffer) {
+    std::string msgId = Protocol::ExtractString(buffer, "clientMsgId");
+    if (msgId.empty()) return;
+
+    CsLock lock(G.csSymbols);
+    if (G.marginPendingByMsgId.erase(msgId)) return;
+    auto detail = G.detailPendingByMsgId.find(msgId);
+    if (detail != G.detailPendingByMsgId.end()) {
+        ReleaseDetailRequestLocked(detail->second);
+        G.detailPendingByMsgId.erase(detail);
+        return;
+    }
+    auto it = G.conversionPending.find(msgId);
+    if (it != G.conversionPending.end()) {
+        it->second.response.clear();
+        it->second.done = true;
+    }
 }
 
 bool GetSymbol(const char* name, SymbolInfo& out) {
     if (!name || !*name) return false;
-    CsLock lock(G.csSymbols);
+    int handle = GetHandle(name);
+    if (handle < 0) return false;
 
-    std::string actual = FindSymbolName(name);
-    if (actual.empty()) return false;
+    {
+        SymTable::Reader table;
+        const SymbolInfo* sym = table->Find(handle);
+        if (!sym) return false;
+        out = *sym;
+    }
 
-    out = G.symbols[actual];
+    // Overlay the live quote
+    Quote q;
+    if (GetQuote(out.handle, q)) {
+        out.bid = q.bid;
+        out.ask = q.ask;
+        out.high = q.high;
+        out.low = q.low;
+        out.lastQuoteTime = q.lastQuoteTime;
+    }
     return true;
 }
 
 const char* GetNameById(long long symbolId) {
     __declspec(thread) static char name[128];
     name[0] = '\0';
-    CsLock lock(G.csSymbols);
-    auto it = G.symbolIdToName.find(symbolId);
-    if (it != G.symbolIdToName.end()) {
-        strcpy_s(name, it->second.c_str());
+    SymTable::Reader table;
+    const SymbolInfo* sym = table->Find(GetHandleById(symbolId));
+    if (sym) {
+        strcpy_s(name, sym->name.c_str());
     }
     return name;
 }
@@ -392,7 +1062,7 @@ static bool RequestConversionChain(long long firstAssetId, long long lastAssetId
     G.conversionResponseReady = false;
     G.waitingForConversion = true;
 
-    if (!WebSocket::Send(msg)) {
+    if (!WebSocket::Send(msg, ToInt(PayloadType::SymbolsForConversionReq))) {
         G.waitingForConversion = false;
         Log::Warn("CONV", "SymbolsForConversionReq send failed (first=%lld last=%lld)", firstAssetId, lastAssetId);
         return false;
@@ -418,6 +1088,18 @@ void HandleSymbolsForConversionRes(const char* buffer) {
     // Parse the conversion chain into the pending quoteAssetId's ConvInfo
     // This is called from NetworkThread context — just copy to buffer and signal
 
+    // Pipelined request: keep the response for CompleteConversionChains
+    {
+        std::string msgId = Protocol::ExtractString(buffer, "clientMsgId");
+        CsLock lock(G.csSymbols);
+        auto it = G.conversionPending.find(msgId);
+        if (it != G.conversionPending.end()) {
+            it->second.response = buffer;
+            it->second.done = true;
+            return;
+        }
+    }
+
     // Copy response to shared buffer
     int len = (int)strlen(buffer);
     int copyLen = (len < State::CONV_BUF_SIZE - 1) ? len : State::CONV_BUF_SIZE - 1;
@@ -426,9 +1108,12 @@ void HandleSymbolsForConversionRes(const char* buffer) {
     G.conversionResponseReady = true;
 }
 
-// Parse the conversion response buffer and store chain
-static void ParseConversionResponse(long long quoteAssetId) {
-    const char* arr = Protocol::ExtractArray(G.conversionResponseBuf, "symbol");
+// Parse a conversion response and store the chain. Chain symbols that are not
+// subscribed yet are subscribed one by one, or returned in toSubscribe if given.
+// Chain symbols that are not subscribed yet are appended to toSubscribe
+static void ParseConversionResponse(const char* buffer, long long quoteAssetId,
+                                    std::vector<std::string>& toSubscribe) {
+    const char* arr = Protocol::ExtractArray(buffer, "symbol");
     if (!arr || *arr == '\0') {
         // Empty chain = same currency (rate = 1.0)
         G.quoteToDepositConv[quoteAssetId].loaded = true;
@@ -441,8 +1126,6 @@ static void ParseConversionResponse(long long quoteAssetId) {
     info.chain.clear();
 
     // Collect chain entries and symbols to subscribe
-    std::vector<std::string> toSubscribe;
-
     for (int i = 0; i < count; i++) {
         const char* elem = Protocol::GetArrayElement(arr, i);
         if (!elem) continue;
@@ -460,23 +1143,26 @@ static void ParseConversionResponse(long long quoteAssetId) {
         // Check if chain symbol needs subscribing
         if (entry.symbolId > 0) {
             CsLock lock(G.csSymbols);
-            auto it = G.symbolIdToName.find(entry.symbolId);
-            if (it != G.symbolIdToName.end()) {
-                auto sit = G.symbols.find(it->second);
-                if (sit != G.symbols.end() && !sit->second.subscribed) {
-                    toSubscribe.push_back(it->second);
-                }
+            SymbolInfo* sym = SymbolByHandleLocked(GetHandleById(entry.symbolId));
+            if (sym && !sym->subscribed) {
+                toSubscribe.push_back(sym->name);
             }
         }
     }
 
     info.loaded = true;
     Log::Info("CONV", "Loaded %d-symbol chain for quoteAssetId=%lld", count, quoteAssetId);
+}
 
-    // Subscribe chain symbols AFTER parsing (no lock held)
-    for (const auto& name : toSubscribe) {
-        Subscribe(name.c_str());
+// Every chain symbol has a bid
+static bool ChainQuoted(long long quoteAssetId) {
+    auto it = G.quoteToDepositConv.find(quoteAssetId);
+    if (it == G.quoteToDepositConv.end()) return false;
+    for (const auto& entry : it->second.chain) {
+        Quote q;
+        if (!GetQuote(GetHandleById(entry.symbolId), q) || q.bid <= 0) return false;
     }
+    return true;
 }
 
 // Compute conversion rate by traversing the chain with current bid prices
@@ -492,17 +1178,8 @@ static double ComputeRateFromChain(long long quoteAssetId) {
 
     for (const auto& entry : chain) {
         // Find bid price for this chain symbol
-        double bid = 0.0;
-        {
-            CsLock lock(G.csSymbols);
-            auto sit = G.symbolIdToName.find(entry.symbolId);
-            if (sit != G.symbolIdToName.end()) {
-                auto symIt = G.symbols.find(sit->second);
-                if (symIt != G.symbols.end()) {
-                    bid = symIt->second.bid;
-                }
-            }
-        }
+        Quote q;
+        double bid = GetQuote(GetHandleById(entry.symbolId), q) ? PriceToDouble(q.bid) : 0.0;
 
         if (bid <= 0.0) {
             Log::Warn("CONV", "No bid for chain symbol id=%lld, rate=1.0", entry.symbolId);
@@ -529,10 +1206,42 @@ double GetQuoteToDepositRate(const SymbolInfo& sym) {
     // Case 1: Quote = deposit currency (EUR/USD on USD account)
     if (sym.quoteAssetId == G.depositAssetId) return 1.0;
 
+    // Local asset graph: kept current by every quote on the path
+    double rate = Rates::QuoteToDeposit(sym.handle);
+    if (rate > 0.0) return rate;
+
+    if (Rates::HasPath(sym.handle) && !s_pathSubscribed[sym.handle]) {
+        // Path symbols not quoted yet: subscribe them and wait for first quotes (once per symbol)
+        s_pathSubscribed[sym.handle] = true;
+        std::vector<int> path;
+        Rates::PathSymbols(sym.handle, path);
+        std::vector<std::string> names;
+        {
+            CsLock lock(G.csSymbols);
+            for (int h : path) {
+                SymbolInfo* s = SymbolByHandleLocked(h);
+                if (s) names.push_back(s->name);
+            }
+        }
+        SubscribeMany(names);
+
+        ULONGLONG start = GetTickCount64();
+        while (GetTickCount64() - start < 2000) {
+            rate = Rates::QuoteToDeposit(sym.handle);
+            if (rate > 0.0) return rate;
+            Sleep(20);
+            if (BrokerProgress) BrokerProgress(1);
+        }
+        Log::Warn("CONV", "No quotes on conversion path for %s (%d hops), falling back to server chain",
+                  sym.name.c_str(), (int)path.size());
+    }
+
+    // No local path: server conversion chain (SymbolsForConversionReq)
+
     // Case 2: Base = deposit currency (USD/JPY on USD account)
     if (sym.baseAssetId == G.depositAssetId) {
-        double price = sym.bid > 0.0 ? sym.bid : sym.ask;
-        return (price > 0.0) ? (1.0 / price) : 1.0;
+        Price price = sym.bid > 0 ? sym.bid : sym.ask;
+        return (price > 0) ? (1.0 / PriceToDouble(price)) : 1.0;
     }
 
     // Case 3: Cross pair — need conversion chain
@@ -540,7 +1249,19 @@ double GetQuoteToDepositRate(const SymbolInfo& sym) {
     if (it == G.quoteToDepositConv.end() || !it->second.loaded) {
         // Lazy load: request chain from server
         if (RequestConversionChain(sym.quoteAssetId, G.depositAssetId)) {
-            ParseConversionResponse(sym.quoteAssetId);
+            std::vector<std::string> legs;
+            ParseConversionResponse(G.conversionResponseBuf, sym.quoteAssetId, legs);
+
+            // The asset's lease now covers its server legs: one SubscribeSpotsReq
+            // with conversion leases, then wait for their first quotes
+            if (!legs.empty()) {
+                Subs::UseHandles(std::vector<int>(1, sym.handle));
+                ULONGLONG start = GetTickCount64();
+                while (GetTickCount64() - start < 2000 && !ChainQuoted(sym.quoteAssetId)) {
+                    Sleep(20);
+                    if (BrokerProgress) BrokerProgress(1);
+                }
+            }
         } else {
             // Mark as loaded with empty chain to avoid retrying
             G.quoteToDepositConv[sym.quoteAssetId].loaded = true;
@@ -551,4 +1272,58 @@ double GetQuoteToDepositRate(const SymbolInfo& sym) {
     return ComputeRateFromChain(sym.quoteAssetId);
 }
 
+bool NeedsConversionChain(const SymbolInfo& sym) {
+    if (G.depositAssetId <= 0 || sym.quoteAssetId <= 0) return false;
+    if (sym.quoteAssetId == G.depositAssetId || sym.baseAssetId == G.depositAssetId) return false;
+    auto it = G.quoteToDepositConv.find(sym.quoteAssetId);
+    return it == G.quoteToDepositConv.end() || !it->second.loaded;
+}
+
+std::string RequestConversionChainAsync(long long quoteAssetId) {
+    std::string msgId = Utils::NextMsgId();
+    char payload[256];
+    sprintf_s(payload, "\"ctidTraderAccountId\":%lld,\"firstAssetId\":%lld,\"lastAssetId\":%lld",
+              G.accountId, quoteAssetId, G.depositAssetId);
+    {
+        CsLock lock(G.csSymbols);
+        State::ConvPending& p = G.conversionPending[msgId];
+        p.quoteAssetId = quoteAssetId;
+    }
+
+    const char* msg = Protocol::BuildMessage(msgId.c_str(), PayloadType::SymbolsForConversionReq, payload);
+    if (!WebSocket::Send(msg, ToInt(PayloadType::SymbolsForConversionReq))) {
+        CsLock lock(G.csSymbols);
+        G.conversionPending.erase(msgId);
+        Log::Warn("CONV", "SymbolsForConversionReq send failed (first=%lld last=%lld)",
+                  quoteAssetId, G.depositAssetId);
+        return "";
+    }
+    return msgId;
+}
+
+void CompleteConversionChains(std::vector<std::string>& chainSymbols) {
+    std::vector<State::ConvPending> done;
+    {
+        CsLock lock(G.csSymbols);
+        for (auto it = G.conversionPending.begin(); it != G.conversionPending.end();) {
+            if (it->second.done) {
+                done.push_back(std::move(it->second));
+                it = G.conversionPending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (const auto& p : done) {
+        if (p.response.empty()) {
+            // Server error: same fallback as a timed-out synchronous request
+            G.quoteToDepositConv[p.quoteAssetId].loaded = true;
+            Log::Warn("CONV", "SymbolsForConversionReq failed for quoteAssetId=%lld, rate=1.0", p.quoteAssetId);
+            continue;
+        }
+        ParseConversionResponse(p.response.c_str(), p.quoteAssetId, chainSymbols);
+    }
+}
+
 } // namespace Symbols
@@ -0,0 +1,343 @@
+#include "../include/state.h"
+#include "../include/symcache.h"
+#include "../include/symbols.h"
+#include "../include/rates.h"
+#include "../include/protocol.h"
+#include "../include/websocket.h"
+#include "../include/logger.h"
+#include "../include/utils.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace SymCache {
+
+// ============================================================
+// File format (little endian, fixed-size records)
+// Header | SymbolRecord * symbolCount | ConvRecord + chain entries ... | FNV-1a checksum
+// ============================================================
+
+static constexpr char MAGIC[4] = { 'C', 'T', 'S', 'C' };
+static constexpr unsigned VERSION = 2;
+
+#pragma pack(push, 4)
+struct FileHeader {
+    char magic[4];
+    unsigned version;
+    long long accountId;
+    int env;
+    int moneyDigits;
+    long long depositAssetId;
+    long long leverageInCents;
+    long long savedUnixMs;
+    unsigned symbolCount;
+    unsigned convCount;
+};
+
+struct SymbolRecord {
+    long long symbolId, baseAssetId, quoteAssetId;
+    long long lotSize, minVolume, maxVolume, stepVolume, commissionRaw;
+    double swapLong, swapShort, marginPerLot;
+    int digits, pipPosition, swapCalculationType, commissionType;
+    int flags;  // SYMBOL_DETAILS: contract fields are from SymbolByIdRes
+    char name[64];
+};
+
+static constexpr int SYMBOL_DETAILS = 1;
+
+struct ConvRecord {
+    long long quoteAssetId;
+    unsigned count;  // ConvChainEntry records that follow
+};
+
+struct ChainRecord {
+    long long symbolId, baseAssetId, quoteAssetId;
+};
+#pragma pack(pop)
+
+static std::set<std::string> s_pendingBatches;  // SymbolByIdReq clientMsgIds (NetworkThread)
+static volatile bool s_revalidating = false;
+
+static void BuildPath(char* out, int maxLen) {
+    sprintf_s(out, maxLen, "%scTrader_symbols_%lld.bin", G.dllDir, G.accountId);
+}
+
+static unsigned Fnv1a(const unsigned char* p, size_t n, unsigned h = 2166136261u) {
+    for (size_t i = 0; i < n; i++) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+// ============================================================
+// Save / Load
+// ============================================================
+
+void Save() {
+    if (G.accountId <= 0) return;
+
+    std::vector<unsigned char> buf;
+    auto put = [&buf](const void* p, size_t n) {
+        buf.insert(buf.end(), (const unsigned char*)p, (const unsigned char*)p + n);
+    };
+
+    std::vector<SymbolRecord> records;
+    {
+        CsLock lock(G.csSymbols);
+        records.reserve(G.symbols.size());
+        for (const auto& sym : G.symbols) {
+            if (sym.name.size() >= sizeof(SymbolRecord::name)) continue;
+            SymbolRecord r;
+            memset(&r, 0, sizeof(r));
+            r.symbolId = sym.symbolId;
+            r.baseAssetId = sym.baseAssetId;
+            r.quoteAssetId = sym.quoteAssetId;
+            r.lotSize = sym.lotSize;
+            r.minVolume = sym.minVolume;
+            r.maxVolume = sym.maxVolume;
+            r.stepVolume = sym.stepVolume;
+            r.commissionRaw = sym.commissionRaw;
+            r.swapLong = sym.swapLong;
+            r.swapShort = sym.swapShort;
+            r.marginPerLot = sym.marginPerLot;
+            r.digits = sym.digits;
+            r.pipPosition = sym.pipPosition;
+            r.swapCalculationType = sym.swapCalculationType;
+            r.commissionType = sym.commissionType;
+            r.flags = sym.detailsLoaded ? SYMBOL_DETAILS : 0;
+            strcpy_s(r.name, sym.name.c_str());
+            records.push_back(r);
+        }
+    }
+    if (records.empty()) return;
+
+    unsigned convCount = 0;
+    for (const auto& kv : G.quoteToDepositConv) {
+        if (kv.second.loaded) convCount++;
+    }
+
+    FileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.accountId = G.accountId;
+    h.env = (int)G.env;
+    h.moneyDigits = G.moneyDigits;
+    h.depositAssetId = G.depositAssetId;
+    h.leverageInCents = G.leverageInCents;
+    h.savedUnixMs = (long long)time(nullptr) * 1000LL;
+    h.symbolCount = (unsigned)records.size();
+    h.convCount = convCount;
+
+    put(&h, sizeof(h));
+    put(records.data(), records.size() * sizeof(SymbolRecord));
+    for (const auto& kv : G.quoteToDepositConv) {
+        if (!kv.second.loaded) continue;
+        ConvRecord c = { kv.first, (unsigned)kv.second.chain.size() };
+        put(&c, sizeof(c));
+        for (const auto& e : kv.second.chain) {
+            ChainRecord cr = { e.symbolId, e.baseAssetId, e.quoteAssetId };
+            put(&cr, sizeof(cr));
+        }
+    }
+    unsigned sum = Fnv1a(buf.data(), buf.size());
+    put(&sum, sizeof(sum));
+
+    char path[MAX_PATH], tmp[MAX_PATH];
+    BuildPath(path, MAX_PATH);
+    sprintf_s(tmp, "%s.tmp", path);
+
+    FILE* f = nullptr;
+    fopen_s(&f, tmp, "wb");
+    if (!f) {
+        Log::Warn("SYM", "Snapshot write failed: %s", tmp);
+        return;
+    }
+    bool ok = fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+    fclose(f);
+    if (!ok || !MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING)) {
+        Log::Warn("SYM", "Snapshot write failed: %s", path);
+        DeleteFileA(tmp);
+        return;
+    }
+    Log::Info("SYM", "Snapshot saved: %u symbols, %u conversion chains (%d KB)",
+              h.symbolCount, convCount, (int)(buf.size() / 1024));
+}
+
+bool Load() {
+    if (G.accountId <= 0) return false;
+
+    char path[MAX_PATH];
+    BuildPath(path, MAX_PATH);
+    FILE* f = nullptr;
+    fopen_s(&f, path, "rb");
+    if (!f) return false;
+
+    std::vector<unsigned char> buf;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size > (long)(sizeof(FileHeader) + sizeof(unsigned))) {
+        buf.resize(size);
+        if (fread(buf.data(), 1, size, f) != (size_t)size) buf.clear();
+    }
+    fclose(f);
+    if (buf.empty()) return false;
+
+    // Checksum covers everything before the trailing 4 bytes
+    unsigned sum;
+    memcpy(&sum, buf.data() + buf.size() - sizeof(sum), sizeof(sum));
+    size_t dataLen = buf.size() - sizeof(sum);
+    if (Fnv1a(buf.data(), dataLen) != sum) {
+        Log::Warn("SYM", "Snapshot checksum mismatch, ignoring %s", path);
+        return false;
+    }
+
+    FileHeader h;
+    memcpy(&h, buf.data(), sizeof(h));
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION ||
+        h.accountId != G.accountId || h.env != (int)G.env || h.symbolCount == 0) {
+        Log::Info("SYM", "Snapshot %s is for another account/version, ignoring", path);
+        return false;
+    }
+
+    size_t pos = sizeof(h);
+    if (pos + (size_t)h.symbolCount * sizeof(SymbolRecord) > dataLen) return false;
+
+    std::vector<SymbolInfo> syms(h.symbolCount);
+    for (unsigned i = 0; i < h.symbolCount; i++, pos += sizeof(SymbolRecord)) {
+        SymbolRecord r;
+        memcpy(&r, buf.data() + pos, sizeof(r));
+        r.name[sizeof(r.name) - 1] = '\0';
+        SymbolInfo& sym = syms[i];
+        sym.symbolId = r.symbolId;
+        sym.name = r.name;
+        sym.baseAssetId = r.baseAssetId;
+        sym.quoteAssetId = r.quoteAssetId;
+        sym.lotSize = r.lotSize;
+        sym.minVolume = r.minVolume;
+        sym.maxVolume = r.maxVolume;
+        sym.stepVolume = r.stepVolume;
+        sym.commissionRaw = r.commissionRaw;
+        sym.swapLong = r.swapLong;
+        sym.swapShort = r.swapShort;
+        sym.marginPerLot = r.marginPerLot;
+        sym.digits = r.digits;
+        sym.pipPosition = r.pipPosition;
+        sym.swapCalculationType = r.swapCalculationType;
+        sym.commissionType = r.commissionType;
+        sym.detailsLoaded = (r.flags & SYMBOL_DETAILS) != 0;
+    }
+
+    std::map<long long, State::ConvInfo> conv;
+    for (unsigned i = 0; i < h.convCount; i++) {
+        if (pos + sizeof(ConvRecord) > dataLen) return false;
+        ConvRecord c;
+        memcpy(&c, buf.data() + pos, sizeof(c));
+        pos += sizeof(c);
+        if (pos + (size_t)c.count * sizeof(ChainRecord) > dataLen) return false;
+
+        State::ConvInfo& info = conv[c.quoteAssetId];
+        info.loaded = true;
+        for (unsigned k = 0; k < c.count; k++, pos += sizeof(ChainRecord)) {
+            ChainRecord cr;
+            memcpy(&cr, buf.data() + pos, sizeof(cr));
+            State::ConvChainEntry e;
+            e.symbolId = cr.symbolId;
+            e.baseAssetId = cr.baseAssetId;
+            e.quoteAssetId = cr.quoteAssetId;
+            info.chain.push_back(e);
+        }
+    }
+
+    Symbols::RestoreSymbols(syms);
+    G.quoteToDepositConv.swap(conv);
+    G.moneyDigits = h.moneyDigits;
+    G.depositAssetId = h.depositAssetId;
+    G.leverageInCents = h.leverageInCents;
+
+    Log::Info("SYM", "Snapshot loaded: %u symbols, %u conversion chains, depositAssetId=%lld",
+              h.symbolCount, h.convCount, h.depositAssetId);
+    return true;
+}
+
+// ============================================================
+// Background revalidation (responses arrive on the NetworkThread)
+// ============================================================
+
+void Revalidate() {
+    s_revalidating = true;
+    char payload[128];
+    sprintf_s(payload, "\"ctidTraderAccountId\":%lld", G.accountId);
+
+    const char* msg = Protocol::BuildMessage(Utils::NextMsgId(), PayloadType::SymbolsListReq, payload);
+    if (!WebSocket::Send(msg, ToInt(PayloadType::SymbolsListReq))) {
+        s_revalidating = false;
+        Log::Warn("SYM", "Revalidation: SymbolsListReq send failed, keeping snapshot");
+        return;
+    }
+    msg = Protocol::BuildMessage(Utils::NextMsgId(), PayloadType::TraderReq, payload);
+    WebSocket::Send(msg, ToInt(PayloadType::TraderReq));
+    Log::Info("SYM", "Revalidating symbol snapshot in background");
+}
+
+void OnSymbolList() {
+    if (!s_revalidating) return;
+
+    std::vector<long long> ids;
+    {
+        CsLock lock(G.csSymbols);
+        // Lazy details: refresh only what was loaded, the rest comes on first use
+        for (const auto& sym : G.symbols) {
+            if (sym.symbolId <= 0) continue;  // dropped from the list
+            if (!G.lazyDetails || sym.detailsLoaded) ids.push_back(sym.symbolId);
+        }
+    }
+
+    // All detail batches pipelined, answers matched by clientMsgId
+    const int BATCH = 50;
+    s_pendingBatches.clear();
+    for (size_t offset = 0; offset < ids.size(); offset += BATCH) {
+        std::string payload = "\"ctidTraderAccountId\":" + std::to_string(G.accountId) + ",\"symbolId\":[";
+        for (size_t j = offset; j < ids.size() && j < offset + BATCH; j++) {
+            if (j > offset) payload += ",";
+            payload += std::to_string(ids[j]);
+        }
+        payload += "]";
+        std::string msgId = Utils::NextMsgId();
+        const char* msg = Protocol::BuildMessage(msgId.c_str(), PayloadType::SymbolByIdReq, payload.c_str());
+        if (WebSocket::Send(msg, ToInt(PayloadType::SymbolByIdReq))) s_pendingBatches.insert(msgId);
+    }
+    if (s_pendingBatches.empty()) {
+        Rates::Build();
+        s_revalidating = false;
+    }
+}
+
+// One revalidation batch answered; the last one rebuilds the asset graph
+static void BatchDone(const char* buffer, bool failed) {
+    if (!s_revalidating) return;
+    if (!s_pendingBatches.erase(Protocol::ExtractString(buffer, "clientMsgId"))) return;
+    if (failed) Log::Warn("SYM", "Revalidation batch failed, keeping snapshot details");
+    if (!s_pendingBatches.empty()) return;
+
+    Rates::Build();
+    s_revalidating = false;
+    Log::Info("SYM", "Symbol snapshot revalidated (%d symbols)", (int)G.symbols.size());
+}
+
+void OnSymbolDetails(const char* buffer) {
+    BatchDone(buffer, false);
+}
+
+void OnRequestError(const char* buffer) {
+    BatchDone(buffer, true);
+}
+
+bool IsRevalidating() {
+    return s_revalidating;
+}
+
+} // namespace SymCache
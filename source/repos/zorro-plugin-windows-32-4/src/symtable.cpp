@@ -0,0 +1,217 @@
+#include "../include/state.h"
+#include "../include/symtable.h"
+#include <atomic>
+#include <climits>
+#include <vector>
+
+namespace SymTable {
+
+typedef std::unordered_map<std::string, int> Names;
+
+static const Names s_noNames;
+static const Table s_empty = { 0, 0, {}, &s_noNames };
+
+static std::atomic<const Table*> s_current{&s_empty};
+static long long s_version = 0;  // csSymbols
+
+// ============================================================
+// Epoch-based reclamation
+// A reader announces the global epoch in its slot, then loads the table.
+// A writer swaps the table, then advances the epoch; whatever it replaced is
+// tagged with the epoch before the advance. A reader that announced a later
+// epoch loaded the new table, so an object is freed once every announced
+// epoch is above its tag. A thread claims a free slot on its first read
+// and gives it back with ReleaseThread().
+// ============================================================
+
+static constexpr int READER_SLOTS = 64;
+
+struct alignas(64) ReaderSlot {
+    std::atomic<unsigned long long> epoch{0};  // 0 = not reading
+    volatile LONG owned = 0;
+};
+
+static ReaderSlot s_slots[READER_SLOTS];
+static std::atomic<unsigned long long> s_epoch{1};
+
+__declspec(thread) static int t_slot = -1;   // -2 = no slot was free, use csSymbols
+__declspec(thread) static int t_depth = 0;   // nested Readers
+
+struct Retired {
+    unsigned long long epoch;
+    void (*free)(const void*);
+    const void* p;
+};
+
+static std::vector<Retired> s_retired;  // csSymbols
+
+template <class T> static void Free(const void* p) { delete static_cast<const T*>(p); }
+
+static int ThreadSlot() {
+    if (t_slot == -1) {
+        t_slot = -2;
+        for (int i = 0; i < READER_SLOTS; i++) {
+            if (InterlockedCompareExchange(&s_slots[i].owned, 1, 0) == 0) {
+                t_slot = i;
+                break;
+            }
+        }
+    }
+    return t_slot;
+}
+
+void ReleaseThread() {
+    if (t_depth > 0) return;  // inside a Reader
+    if (t_slot >= 0) {
+        s_slots[t_slot].epoch.store(0, std::memory_order_release);
+        InterlockedExchange(&s_slots[t_slot].owned, 0);
+    }
+    t_slot = -1;
+}
+
+Reader::Reader() : m_table(nullptr), m_locked(false) {
+    if (t_depth++ == 0) {
+        int slot = ThreadSlot();
+        if (slot >= 0) {
+            s_slots[slot].epoch.store(s_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        } else {
+            EnterCriticalSection(&G.csSymbols);  // writers reclaim under this lock
+            m_locked = true;
+        }
+    }
+    m_table = s_current.load(std::memory_order_seq_cst);
+}
+
+Reader::~Reader() {
+    if (--t_depth > 0) return;
+    if (m_locked) LeaveCriticalSection(&G.csSymbols);
+    else s_slots[t_slot].epoch.store(0, std::memory_order_release);
+}
+
+// Caller holds csSymbols
+static void ReclaimLocked() {
+    unsigned long long oldest = ULLONG_MAX;
+    for (int i = 0; i < READER_SLOTS; i++) {
+        unsigned long long e = s_slots[i].epoch.load(std::memory_order_seq_cst);
+        if (e != 0 && e < oldest) oldest = e;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < s_retired.size(); i++) {
+        if (s_retired[i].epoch < oldest) s_retired[i].free(s_retired[i].p);
+        else s_retired[kept++] = s_retired[i];
+    }
+    s_retired.resize(kept);
+}
+
+// What a publish replaced, freed once no reader can hold it
+struct Replaced {
+    std::vector<const SymbolInfo*> recs;
+    std::vector<const Page*> pages;
+    const Names* names = nullptr;
+};
+
+// Swap in the next table and retire what it replaced. Caller holds csSymbols.
+static void SwapLocked(Table* next, const Replaced& old) {
+    next->version = ++s_version;
+    const Table* prev = s_current.exchange(next, std::memory_order_seq_cst);
+    unsigned long long tag = s_epoch.fetch_add(1, std::memory_order_seq_cst);
+
+    if (prev != &s_empty) s_retired.push_back({ tag, &Free<Table>, prev });
+    for (const Page* p : old.pages)
+        if (p) s_retired.push_back({ tag, &Free<Page>, p });
+    for (const SymbolInfo* r : old.recs)
+        if (r) s_retired.push_back({ tag, &Free<SymbolInfo>, r });
+    if (old.names && old.names != &s_noNames) s_retired.push_back({ tag, &Free<Names>, old.names });
+    ReclaimLocked();
+}
+
+void RetireLocked(void (*free)(const void*), const void* p) {
+    if (!p) return;
+    unsigned long long tag = s_epoch.fetch_add(1, std::memory_order_seq_cst);
+    s_retired.push_back({ tag, free, p });
+    ReclaimLocked();
+}
+
+// ============================================================
+// Writers (csSymbols)
+// ============================================================
+
+void PublishLocked(const std::vector<int>& handles, bool names) {
+    if (handles.empty() && !names) return;
+    const Table* prev = s_current.load(std::memory_order_relaxed);
+    Table* next = new Table(*prev);  // page pointers only
+    next->count = (int)G.symbols.size();
+    next->pages.resize((next->count + PAGE_SIZE - 1) / PAGE_SIZE, nullptr);
+
+    // Copy each touched page once, then replace its records
+    Replaced old;
+    std::vector<Page*> copied(next->pages.size(), nullptr);
+    for (int h : handles) {
+        if (h < 0 || h >= next->count) continue;
+        int p = h / PAGE_SIZE;
+        if (!copied[p]) {
+            const Page* cur = next->pages[p];
+            copied[p] = cur ? new Page(*cur) : new Page();
+            old.pages.push_back(cur);
+            next->pages[p] = copied[p];
+        }
+        const SymbolInfo*& rec = copied[p]->recs[h % PAGE_SIZE];
+        old.recs.push_back(rec);
+        rec = new SymbolInfo(G.symbols[h]);
+    }
+    for (auto& page : next->pages)
+        if (!page) page = new Page();  // new handles not published yet
+
+    if (names) {
+        old.names = prev->names;
+        next->names = new Names(G.symbolAliases);
+    }
+    SwapLocked(next, old);
+}
+
+void PublishLocked(int handle) {
+    PublishLocked(std::vector<int>(1, handle));
+}
+
+void PublishAllLocked() {
+    const Table* prev = s_current.load(std::memory_order_relaxed);
+    Table* next = new Table();
+    next->count = (int)G.symbols.size();
+    next->pages.resize((next->count + PAGE_SIZE - 1) / PAGE_SIZE);
+    for (int p = 0; p < (int)next->pages.size(); p++) {
+        Page* page = new Page();
+        for (int i = 0; i < PAGE_SIZE && p * PAGE_SIZE + i < next->count; i++)
+            page->recs[i] = new SymbolInfo(G.symbols[p * PAGE_SIZE + i]);
+        next->pages[p] = page;
+    }
+    next->names = new Names(G.symbolAliases);
+
+    Replaced old;
+    for (const Page* page : prev->pages) {
+        old.pages.push_back(page);
+        old.recs.insert(old.recs.end(), page->recs, page->recs + PAGE_SIZE);
+    }
+    old.names = prev->names;
+    SwapLocked(next, old);
+}
+
+long long Version() {
+    return s_current.load(std::memory_order_acquire)->version;
+}
+
+void Reset() {
+    CsLock lock(G.csSymbols);
+    const Table* prev = s_current.exchange(&s_empty, std::memory_order_seq_cst);
+    if (prev != &s_empty) {
+        for (const Page* page : prev->pages) {
+            for (const SymbolInfo* r : page->recs) delete r;
+            delete page;
+        }
+        if (prev->names != &s_noNames) delete prev->names;
+        delete prev;
+    }
+    for (const Retired& r : s_retired) r.free(r.p);
+    s_retired.clear();
+}
+
+} // namespace SymTable
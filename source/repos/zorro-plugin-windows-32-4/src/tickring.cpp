@@ -0,0 +1,137 @@
+#include "../include/state.h"
+#include "../include/tickring.h"
+#include "../include/utils.h"
+#include "../include/symtable.h"
+#include <atomic>
+
+namespace TickRing {
+
+// ============================================================
+// Ring per symbol handle
+// Tick i lives in slot i % RING_TICKS. The writer fills slot head and then
+// publishes head + 1, so while tick h is written, tick h - RING_TICKS is
+// being destroyed: a reader trusts only ticks >= head + 1 - RING_TICKS.
+// ============================================================
+
+struct Tick {
+    std::atomic<long long> serverMs{0};
+    std::atomic<long long> bid{0};
+    std::atomic<long long> ask{0};
+};
+
+struct Ring {
+    Tick ticks[RING_TICKS];
+    std::atomic<long long> head{0};        // ticks written
+    std::atomic<long long> epochStart{0};  // first tick after the last break
+    std::atomic<bool> broken{false};       // break pending, applied by the next Push
+};
+
+// Created by Push and retired by ReleaseLocked (NetworkThread); readers pin
+// a SymTable::Reader while they hold a ring
+static std::atomic<Ring*> s_rings[MAX_SYMBOLS];
+
+static void FreeRing(const void* p) { delete static_cast<const Ring*>(p); }
+
+void Push(int handle, long long serverMs, long long rawBid, long long rawAsk) {
+    if (handle < 0 || handle >= MAX_SYMBOLS || serverMs <= 0 || rawBid <= 0 || rawAsk <= 0) return;
+
+    Ring* ring = s_rings[handle].load(std::memory_order_relaxed);
+    if (!ring) {
+        ring = new Ring();
+        s_rings[handle].store(ring, std::memory_order_release);
+    }
+
+    long long h = ring->head.load(std::memory_order_relaxed);
+    if (ring->broken.exchange(false, std::memory_order_acq_rel))
+        ring->epochStart.store(h, std::memory_order_release);
+
+    Tick& t = ring->ticks[h % RING_TICKS];
+    t.serverMs.store(serverMs, std::memory_order_relaxed);
+    t.bid.store(rawBid, std::memory_order_relaxed);
+    t.ask.store(rawAsk, std::memory_order_relaxed);
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+void BreakAll() {
+    SymTable::Reader pin;
+    for (int h = 0; h < MAX_SYMBOLS; h++) {
+        Ring* ring = s_rings[h].load(std::memory_order_acquire);
+        if (ring) ring->broken.store(true, std::memory_order_release);
+    }
+}
+
+void ReleaseLocked(int handle) {
+    if (handle < 0 || handle >= MAX_SYMBOLS) return;
+    Ring* ring = s_rings[handle].exchange(nullptr, std::memory_order_seq_cst);
+    if (ring) SymTable::RetireLocked(&FreeRing, ring);
+}
+
+// ============================================================
+// Reader
+// ============================================================
+
+int Read(int handle, bool live, long long startMs, long long endMs, int maxTicks,
+         T6* out, long long* uncoveredEndMs) {
+    if (handle < 0 || handle >= MAX_SYMBOLS || !out || maxTicks <= 0 || endMs < startMs) return 0;
+    SymTable::Reader pin;
+    const Ring* ring = s_rings[handle].load(std::memory_order_acquire);
+    if (!ring) return 0;
+
+    long long head = ring->head.load(std::memory_order_acquire);
+    long long first = ring->epochStart.load(std::memory_order_acquire);
+    if (head - RING_TICKS + 1 > first) first = head - RING_TICKS + 1;
+    if (head <= first) return 0;
+
+    // Without a running stream the ring ends at its newest tick
+    if (ring->broken.load(std::memory_order_acquire)) live = false;
+    long long newestMs = ring->ticks[(head - 1) % RING_TICKS].serverMs.load(std::memory_order_relaxed);
+    long long coveredToMs = live ? Utils::NowUnixMs() : newestMs;
+    if (endMs > coveredToMs) return 0;
+
+    // Skip the ticks after endMs, then copy newest first
+    long long i = head - 1;
+    while (i >= first && ring->ticks[i % RING_TICKS].serverMs.load(std::memory_order_relaxed) > endMs) i--;
+    long long newestIdx = i;
+    bool reachedStart = false;
+    long long oldestMs = 0;
+    int count = 0;
+    for (; i >= first && count < maxTicks; i--) {
+        const Tick& t = ring->ticks[i % RING_TICKS];
+        long long ms = t.serverMs.load(std::memory_order_relaxed);
+        long long bid = t.bid.load(std::memory_order_relaxed);
+        long long ask = t.ask.load(std::memory_order_relaxed);
+        if (ms < startMs) { reachedStart = true; break; }
+        oldestMs = ms;
+
+        float spread = (float)PriceToDouble(ask - bid);
+        T6& o = out[count++];
+        o.time = Utils::UnixToOle(ms);
+        o.fHigh = o.fLow = o.fOpen = o.fClose = (float)PriceToDouble(bid);
+        o.fVal = spread > 0.0f ? spread : 0.0f;
+        o.fVol = 1.0f;
+    }
+
+    // Drop the oldest copies if the writer lapped them meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    long long safe = ring->head.load(std::memory_order_relaxed) - RING_TICKS + 1;
+    long long lapped = safe - (newestIdx - count + 1);
+    if (lapped > 0) {
+        if (lapped >= count) return 0;
+        count -= (int)lapped;
+        reachedStart = false;
+        oldestMs = Utils::OleToUnix(out[count - 1].time);
+    }
+    if (count == 0) return 0;
+
+    if (uncoveredEndMs) {
+        if (reachedStart || count >= maxTicks) *uncoveredEndMs = startMs - 1;
+        else *uncoveredEndMs = oldestMs - 1;
+    }
+    return count;
+}
+
+void Reset() {
+    for (int h = 0; h < MAX_SYMBOLS; h++) delete s_rings[h].exchange(nullptr);
+}
+
+} // namespace TickRing
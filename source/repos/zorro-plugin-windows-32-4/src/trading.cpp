@@ -2,6 +2,7 @@
 #include "../include/trading.h"
 #include "../include/protocol.h"
 #include "../include/websocket.h"
+#include "../include/stats.h"
 #include "../include/symbols.h"
 #include "../include/logger.h"
 #include "../include/utils.h"
@@ -31,6 +32,15 @@ static int VolumeToZorro(long long vol, int side) {
     return (side == 2) ? -units : units;
 }
 
+// Zorro price (or distance) -> Price on the symbol's tick grid of `digits` decimals.
+// cTrader rejects order prices with more decimals than the symbol has.
+static Price PriceFromDigits(double v, int digits) {
+    if (digits < 0 || digits >= 5) return PriceFromDouble(v);  // PRICE_UNITS grid already
+    long long step = 1;
+    for (int i = digits; i < 5; i++) step *= 10;
+    return (Price)(v * (PRICE_SCALE / (double)step) + 0.5) * step;
+}
+
 // ============================================================
 // Wait for trading response from NetworkThread
 // ============================================================
@@ -78,7 +88,8 @@ int BuyOrder(const char* asset, int amount, double stopDist, double limit,
         return 0;
     }
 
-    // Symbol lookup
+    // Symbol lookup (volume limits need the contract details)
+    Symbols::EnsureDetails(asset);
     SymbolInfo sym;
     if (!Symbols::GetSymbol(asset, sym)) {
         Log::Error("TRADE", "BuyOrder: symbol %s not found", asset);
@@ -107,33 +118,38 @@ int BuyOrder(const char* asset, int amount, double stopDist, double limit,
     }
 
     // Reference price for SL calculation
-    double refPrice = (tradeSide == 1) ? sym.ask : sym.bid;
-    if (refPrice <= 0.0) {
-        Log::Error("TRADE", "BuyOrder: no price for %s (ask=%.5f bid=%.5f)", asset, sym.ask, sym.bid);
+    Price refPrice = (tradeSide == 1) ? sym.ask : sym.bid;
+    if (refPrice <= 0) {
+        Log::Error("TRADE", "BuyOrder: no price for %s (ask=%.5f bid=%.5f)", asset,
+                   PriceToDouble(sym.ask), PriceToDouble(sym.bid));
         return 0;
     }
 
     // Determine order type from G.orderType (set by SET_ORDERTYPE)
     // Zorro: 0=Market(GTC), 2=Limit, 3=Stop
     // cTrader: 1=Market, 2=Limit, 3=Stop
+    // Prices from here on are fixed-point (Price), rounded once from Zorro's doubles
+    // to the symbol's digits (the PRICE_UNITS grid while its details are missing)
     int cTraderOrderType = 1;  // default Market
-    double orderPrice = 0.0;
+    Price orderPrice = 0;
+    int digits = sym.detailsLoaded ? sym.digits : 5;
 
     // SET_LIMIT may provide the price via G.limitPrice instead of BrokerBuy2 Limit param
-    double effectiveLimit = limit;
-    if (effectiveLimit <= 0.0 && G.limitPrice > 0.0) {
-        effectiveLimit = G.limitPrice;
+    Price limitPrice = (G.limitPrice > 0.0) ? PriceFromDigits(G.limitPrice, digits) : 0;
+    Price effectiveLimit = (limit > 0.0) ? PriceFromDigits(limit, digits) : 0;
+    if (effectiveLimit <= 0 && limitPrice > 0) {
+        effectiveLimit = limitPrice;
     }
 
-    if ((G.orderType == 0 || G.orderType == 2) && effectiveLimit > 0.0) {
+    if ((G.orderType == 0 || G.orderType == 2) && effectiveLimit > 0) {
         cTraderOrderType = 2;
         orderPrice = effectiveLimit;
-    } else if (G.orderType == 3 && effectiveLimit > 0.0) {
+    } else if (G.orderType == 3 && effectiveLimit > 0) {
         // StopLimit: if both stopPrice (limit param) and limitPrice (SET_LIMIT) are set
-        if (G.limitPrice > 0.0 && effectiveLimit != G.limitPrice) {
+        if (limitPrice > 0 && effectiveLimit != limitPrice) {
             cTraderOrderType = 6;  // StopLimit
             orderPrice = effectiveLimit;  // BrokerBuy2 Limit param = stop trigger price
-            // G.limitPrice will be used as execution limit price below
+            // limitPrice will be used as execution limit price below
         } else {
             cTraderOrderType = 3;
             orderPrice = effectiveLimit;
@@ -168,59 +184,57 @@ int BuyOrder(const char* asset, int amount, double stopDist, double limit,
         G.accountId, sym.symbolId, cTraderOrderType, tradeSide, vol, labelBuf);
 
     // Add limit/stop price for pending orders
-    if (cTraderOrderType == 2 && orderPrice > 0.0) {
+    if (cTraderOrderType == 2 && orderPrice > 0) {
         off += sprintf_s(payload + off, sizeof(payload) - off,
-            ",\"limitPrice\":%.0f", orderPrice * PRICE_SCALE);
-    } else if (cTraderOrderType == 3 && orderPrice > 0.0) {
+            ",\"limitPrice\":%lld", orderPrice);
+    } else if (cTraderOrderType == 3 && orderPrice > 0) {
         off += sprintf_s(payload + off, sizeof(payload) - off,
-            ",\"stopPrice\":%.0f", orderPrice * PRICE_SCALE);
-    } else if (cTraderOrderType == 6 && orderPrice > 0.0) {
+            ",\"stopPrice\":%lld", orderPrice);
+    } else if (cTraderOrderType == 6 && orderPrice > 0) {
         // StopLimit: stopPrice = trigger, limitPrice = execution limit
         off += sprintf_s(payload + off, sizeof(payload) - off,
-            ",\"stopPrice\":%.0f,\"limitPrice\":%.0f",
-            orderPrice * PRICE_SCALE, G.limitPrice * PRICE_SCALE);
+            ",\"stopPrice\":%lld,\"limitPrice\":%lld", orderPrice, limitPrice);
     }
 
     // SL/TP handling:
     // Zorro convention: stopDist > 0 = stop loss distance, stopDist < 0 = take profit distance
-    double slDist = 0.0;
-    double tpDist = 0.0;
+    Price slDist = 0;
+    Price tpDist = 0;
+    // Distances on the same grid, so absolute SL/TP from orderPrice stay on it
     if (stopDist > 0.0) {
-        slDist = stopDist;
+        slDist = PriceFromDigits(stopDist, digits);
     } else if (stopDist < 0.0) {
-        tpDist = -stopDist;  // make positive
+        tpDist = PriceFromDigits(-stopDist, digits);  // make positive
     }
 
     // SL for market orders: use relativeStopLoss (distance in points)
     // cTrader rejects absolute SL/TP on market orders
-    if (cTraderOrderType == 1 && slDist > 0.0) {
-        long long slPoints = (long long)(slDist * PRICE_SCALE);
+    if (cTraderOrderType == 1 && slDist > 0) {
         off += sprintf_s(payload + off, sizeof(payload) - off,
-            ",\"relativeStopLoss\":%lld", slPoints);
+            ",\"relativeStopLoss\":%lld", slDist);
     }
 
     // TP for market orders: use relativeTakeProfit (distance in points)
-    if (cTraderOrderType == 1 && tpDist > 0.0) {
-        long long tpPoints = (long long)(tpDist * PRICE_SCALE);
+    if (cTraderOrderType == 1 && tpDist > 0) {
         off += sprintf_s(payload + off, sizeof(payload) - off,
-            ",\"relativeTakeProfit\":%lld", tpPoints);
+            ",\"relativeTakeProfit\":%lld", tpDist);
     }
 
     // SL for limit/stop orders: use absolute stopLoss price
-    if (cTraderOrderType != 1 && slDist > 0.0) {
-        double slPrice = (tradeSide == 1) ? (orderPrice - slDist) : (orderPrice + slDist);
-        if (slPrice > 0.0) {
+    if (cTraderOrderType != 1 && slDist > 0) {
+        Price slPrice = (tradeSide == 1) ? (orderPrice - slDist) : (orderPrice + slDist);
+        if (slPrice > 0) {
             off += sprintf_s(payload + off, sizeof(payload) - off,
-                ",\"stopLoss\":%.0f", slPrice * PRICE_SCALE);
+                ",\"stopLoss\":%lld", slPrice);
         }
     }
 
     // TP for limit/stop orders: use absolute takeProfit price
-    if (cTraderOrderType != 1 && tpDist > 0.0) {
-        double tpPrice = (tradeSide == 1) ? (orderPrice + tpDist) : (orderPrice - tpDist);
-        if (tpPrice > 0.0) {
+    if (cTraderOrderType != 1 && tpDist > 0) {
+        Price tpPrice = (tradeSide == 1) ? (orderPrice + tpDist) : (orderPrice - tpDist);
+        if (tpPrice > 0) {
             off += sprintf_s(payload + off, sizeof(payload) - off,
-                ",\"takeProfit\":%.0f", tpPrice * PRICE_SCALE);
+                ",\"takeProfit\":%lld", tpPrice);
         }
     }
 
@@ -240,7 +254,8 @@ int BuyOrder(const char* asset, int amount, double stopDist, double limit,
 
     Log::Info("TRADE", "NewOrder: %s %s amount=%d vol=%lld type=%d zorroId=%d SL=%.5f TP=%.5f limit=%.5f orderPrice=%.5f label=%s",
               (tradeSide == 1) ? "BUY" : "SELL", asset, amount, vol, cTraderOrderType, zorroId,
-              slDist, tpDist, effectiveLimit, orderPrice, labelBuf);
+              PriceToDouble(slDist), PriceToDouble(tpDist), PriceToDouble(effectiveLimit),
+              PriceToDouble(orderPrice), labelBuf);
 
     // Set waiting flag and send
     {
@@ -249,7 +264,7 @@ int BuyOrder(const char* asset, int amount, double stopDist, double limit,
         G.waitingForTrading = true;
     }
 
-    if (!WebSocket::Send(msg)) {
+    if (!WebSocket::Send(msg, ToInt(PayloadType::NewOrderReq))) {
         Log::Error("TRADE", "NewOrder send failed");
         G.waitingForTrading = false;
         CsLock lock(G.csTrades);
@@ -381,7 +396,7 @@ int BuyOrder(const char* asset, int amount, double stopDist, double limit,
                     ti.symbol = asset;
                     ti.volume = vol;
                     ti.tradeSide = tradeSide;
-                    ti.openPrice = orderPrice;
+                    ti.openPrice = PriceToDouble(orderPrice);
                     ti.stopLoss = 0.0;
                     ti.takeProfit = 0.0;
                     ti.open = true;
@@ -389,10 +404,10 @@ int BuyOrder(const char* asset, int amount, double stopDist, double limit,
                     G.pendingActions.erase(msgId);
                 }
 
-                if (pPrice) *pPrice = orderPrice;
+                if (pPrice) *pPrice = PriceToDouble(orderPrice);
 
                 Log::Info("TRADE", "Pending order accepted: zorroId=%d orderId=%lld price=%.5f",
-                          zorroId, ordId, orderPrice);
+                          zorroId, ordId, PriceToDouble(orderPrice));
                 // Reset per-order state
                 G.limitPrice = 0.0;
                 G.orderLabel.clear();
@@ -525,6 +540,7 @@ int SellOrder(int tradeId, int amount, double limit,
     }
 
     // Get symbol info for volume conversion
+    Symbols::EnsureDetails(ti.symbol.c_str());
     SymbolInfo sym;
     if (!Symbols::GetSymbol(ti.symbol.c_str(), sym)) {
         Log::Error("TRADE", "SellOrder: symbol %s not found", ti.symbol.c_str());
@@ -574,7 +590,7 @@ int SellOrder(int tradeId, int amount, double limit,
             G.waitingForTrading = true;
         }
 
-        if (!WebSocket::Send(msg)) {
+        if (!WebSocket::Send(msg, ToInt(PayloadType::ClosePositionReq))) {
             Log::Error("TRADE", "ClosePosition send failed");
             G.waitingForTrading = false;
             // Check if position was closed externally (SL/TP) before retrying
@@ -869,7 +885,7 @@ int GetTradeStatus(int tradeId, double* pOpen, double* pClose,
     SymbolInfo sym;
     double closePrice = 0.0;
     if (Symbols::GetSymbol(ti.symbol.c_str(), sym)) {
-        closePrice = (ti.tradeSide == 1) ? sym.bid : sym.ask;
+        closePrice = PriceToDouble((ti.tradeSide == 1) ? sym.bid : sym.ask);
     }
 
     if (pOpen) *pOpen = ti.openPrice;
@@ -1054,7 +1070,7 @@ bool QueryClosedPositionFromServer(long long positionId, double* closePrice, dou
         G.waitingForTrading = true;
     }
 
-    if (!WebSocket::Send(msg)) {
+    if (!WebSocket::Send(msg, ToInt(PayloadType::DealListByPositionIdReq))) {
         Log::Error("TRADE", "QueryClosedPosition send failed");
         G.waitingForTrading = false;
         return false;
@@ -1158,7 +1174,7 @@ bool RequestReconcile() {
 
     Log::Info("TRADE", "Requesting position reconciliation");
 
-    if (!WebSocket::Send(msg)) {
+    if (!WebSocket::Send(msg, ToInt(PayloadType::ReconcileReq))) {
         Log::Error("TRADE", "ReconcileReq send failed");
         return false;
     }
@@ -1170,6 +1186,7 @@ bool RequestReconcile() {
         int n = WebSocket::Receive(response, sizeof(response));
         if (n > 0) {
             int pt = Protocol::ExtractPayloadType(response);
+            Stats::RecordReceive(pt, n);
             if (pt == ToInt(PayloadType::ReconcileRes)) {
                 HandleReconcileRes(response);
                 return true;
@@ -1373,7 +1390,7 @@ bool CancelOrder(int tradeId) {
         G.waitingForTrading = true;
     }
 
-    if (!WebSocket::Send(msg)) {
+    if (!WebSocket::Send(msg, ToInt(PayloadType::CancelOrderReq))) {
         Log::Error("TRADE", "CancelOrder send failed");
         G.waitingForTrading = false;
         return false;
@@ -1447,6 +1464,10 @@ bool AmendPositionSltp(int tradeId, double stopLoss, double takeProfit) {
         return false;
     }
 
+    // SL/TP on the symbol's price grid, like the order they protect
+    SymbolInfo sym;
+    int digits = (Symbols::GetSymbol(ti.symbol.c_str(), sym) && sym.detailsLoaded) ? sym.digits : 5;
+
     // Build AmendPositionSltpReq payload
     char payload[512];
     int off = sprintf_s(payload,
@@ -1457,13 +1478,13 @@ bool AmendPositionSltp(int tradeId, double stopLoss, double takeProfit) {
     // SL: 0 = omit field (removes SL), >0 = set SL price
     if (stopLoss > 0.0) {
         off += sprintf_s(payload + off, sizeof(payload) - off,
-            ",\"stopLoss\":%.0f", stopLoss * PRICE_SCALE);
+            ",\"stopLoss\":%lld", PriceFromDigits(stopLoss, digits));
     }
 
     // TP: 0 = omit field (removes TP), >0 = set TP price
     if (takeProfit > 0.0) {
         off += sprintf_s(payload + off, sizeof(payload) - off,
-            ",\"takeProfit\":%.0f", takeProfit * PRICE_SCALE);
+            ",\"takeProfit\":%lld", PriceFromDigits(takeProfit, digits));
     }
 
     const char* msgId = Utils::NextMsgId();
@@ -1479,7 +1500,7 @@ bool AmendPositionSltp(int tradeId, double stopLoss, double takeProfit) {
         G.waitingForTrading = true;
     }
 
-    if (!WebSocket::Send(msg)) {
+    if (!WebSocket::Send(msg, ToInt(PayloadType::AmendPositionSltpReq))) {
         Log::Error("TRADE", "AmendSLTP send failed");
         G.waitingForTrading = false;
         return false;
@@ -1579,7 +1600,7 @@ bool RefreshUnrealizedPnL() {
     G.pnlResponseReady = false;
     G.waitingForPnL = true;
 
-    if (!WebSocket::Send(msg)) {
+    if (!WebSocket::Send(msg, ToInt(PayloadType::GetPositionUnrealizedPnLReq))) {
         G.waitingForPnL = false;
         Log::Warn("PNL", "RefreshUnrealizedPnL send failed");
         return false;
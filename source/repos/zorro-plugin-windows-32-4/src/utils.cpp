@@ -58,4 +58,24 @@ ULONGLONG NowMs() {
     return GetTickCount64();
 }
 
+// FILETIME: 100ns units since Jan 1, 1601
+static long long FileTimeToUnix100ns(const FILETIME& ft) {
+    ULARGE_INTEGER u;
+    u.LowPart = ft.dwLowDateTime;
+    u.HighPart = ft.dwHighDateTime;
+    return (long long)(u.QuadPart - 116444736000000000ULL);
+}
+
+long long NowUnixMs() {
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    return FileTimeToUnix100ns(ft) / 10000;
+}
+
+long long NowUnixUs() {
+    FILETIME ft;
+    GetSystemTimePreciseAsFileTime(&ft);
+    return FileTimeToUnix100ns(ft) / 10;
+}
+
 } // namespace Utils
@@ -1,6 +1,7 @@
 #include "../include/state.h"
 #include "../include/websocket.h"
 #include "../include/logger.h"
+#include "../include/stats.h"
 #include <cstdio>
 
 namespace WebSocket {
@@ -120,7 +121,7 @@ void Disconnect() {
     Log::Info("WS", "Disconnected");
 }
 
-bool Send(const char* message) {
+bool Send(const char* message, int payloadType) {
     CsLock lock(G.csWebSocket);  // Bug #9: lock during send
 
     if (!G.hWebSocket || !G.wsConnected || !message) return false;
@@ -135,6 +136,7 @@ bool Send(const char* message) {
         return false;
     }
 
+    Stats::RecordSend(payloadType, (int)len);
     Log::Diag(2, "SEND: %s", message);
     return true;
 }